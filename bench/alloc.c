@@ -0,0 +1,87 @@
+#include "bench.h"
+
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <alloc.h>
+
+#define SLOTS 1024
+#define OPS (1 << 18)
+
+/*
+ * fox_alloc_options is read once per process, so every combination of C, F,
+ * D and Q runs in a child of its own. D writes its report at exit, the
+ * children leave with _exit and skip it.
+ */
+static const char *const combinations[] = {
+    "", "C", "F", "D", "Q", "CF", "CD", "CQ", "FD", "FQ", "DQ", "CFD", "CFQ",
+    "CDQ", "FDQ", "CFDQ",
+};
+
+static void *slots[SLOTS];
+
+static inline u32 next(u32 *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+/* frees and allocates in random slots, sizes between 16 and 1024 bytes */
+#define CHURN(alloc, release) do {                                          \
+    u32 state = 2463534242u;                                                \
+    for (usize i = 0; i < OPS; i++) {                                       \
+        u32 r = next(&state);                                               \
+        void **slot = slots + (r % SLOTS);                                  \
+        if (*slot != NULL)                                                  \
+            release(*slot);                                                 \
+        *slot = alloc(16 + (r >> 16) % 1009);                               \
+        *(u8*) *slot = r;                                                   \
+    }                                                                       \
+    for (usize i = 0; i < SLOTS; i++) {                                     \
+        if (slots[i] != NULL)                                               \
+            release(slots[i]);                                              \
+        slots[i] = NULL;                                                    \
+    }                                                                       \
+} while (0)
+
+static void run(const char *options)
+{
+    char label[64];
+
+    fox_alloc_options = options;
+    snprintf(label, sizeof(label), "fox_alloc churn %s",
+        *options ? options : "none");
+    BENCH(label, OPS, CHURN(fox_alloc, fox_free));
+}
+
+int main()
+{
+    BENCH("malloc churn", OPS, CHURN(malloc, free));
+
+    for (usize i = 0; i < sizeof(combinations) / sizeof(*combinations); i++) {
+        pid_t pid = fork();
+        int status;
+
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+
+        if (pid == 0) {
+            run(combinations[i]);
+            _exit(0);
+        }
+
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "fox_alloc churn '%s' failed\n",
+                combinations[i]);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include <num.h>
+
+/*
+ * Minimal timing helpers for the programs in bench/. Each benchmark runs its
+ * body BENCH_ROUNDS times and reports the best round, which is the least
+ * disturbed by the rest of the system.
+ *
+ * FOX_BENCH_FORMAT picks the output: text (default), csv or json, the latter
+ * one object per line. The csv columns, without a header row, are
+ *
+ *      bench,label,ns_per_op,cycles,instructions,cache_misses,branch_misses
+ *
+ * With FOX_BENCH_PERF=1 the hardware counters of the best round are read
+ * through perf_event_open and divided by n like the time. They stay empty
+ * (null in json) when the kernel does not let us open them.
+ */
+#define BENCH_ROUNDS 5
+
+enum bench_counter {
+    BENCH_CYCLES,
+    BENCH_INSTRUCTIONS,
+    BENCH_CACHE_MISSES,
+    BENCH_BRANCH_MISSES,
+    BENCH_COUNTERS,
+};
+
+static const char *const bench_counter_names[BENCH_COUNTERS] = {
+    "cycles", "instructions", "cache_misses", "branch_misses",
+};
+
+struct bench_sample {
+    u64 ns;
+    u64 counters[BENCH_COUNTERS];
+    bool counted;
+};
+
+static inline u64 bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* keeps the compiler from dropping results nobody reads */
+static inline void bench_use(const void *p)
+{
+    __asm__ volatile("" : : "r"(p) : "memory");
+}
+
+/*
+ * The counters as one group, fds[0] leads it, -1 when perf is off. They only
+ * count the process that opened them, a forked child opens its own.
+ */
+static inline int *bench_perf_fds(void)
+{
+    static int fds[BENCH_COUNTERS] = { -1, -1, -1, -1 };
+    static pid_t owner = 0;
+
+    if (owner == getpid())
+        return fds;
+    owner = getpid();
+
+    for (int i = 0; i < BENCH_COUNTERS; i++) {
+        if (fds[i] >= 0)
+            close(fds[i]);
+        fds[i] = -1;
+    }
+
+    const char *perf = getenv("FOX_BENCH_PERF");
+    if (perf == NULL || strcmp(perf, "1") != 0)
+        return fds;
+
+#ifdef __linux__
+    static const u64 configs[BENCH_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    for (int i = 0; i < BENCH_COUNTERS; i++) {
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1,
+            i == 0 ? -1 : fds[0], 0);
+
+        if (fds[i] < 0) {
+            for (int j = 0; j < i; j++)
+                close(fds[j]);
+            for (int j = 0; j < BENCH_COUNTERS; j++)
+                fds[j] = -1;
+            fprintf(stderr, "bench: perf counters unavailable\n");
+            break;
+        }
+    }
+#endif
+
+    return fds;
+}
+
+static inline void bench_start(struct bench_sample *s)
+{
+    int *fds = bench_perf_fds();
+
+#ifdef __linux__
+    if (fds[0] >= 0) {
+        ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#else
+    (void) fds;
+#endif
+
+    s->ns = bench_now();
+}
+
+static inline void bench_stop(struct bench_sample *s)
+{
+    int *fds = bench_perf_fds();
+
+    s->ns = bench_now() - s->ns;
+    s->counted = false;
+
+#ifdef __linux__
+    if (fds[0] < 0)
+        return;
+
+    ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    s->counted = true;
+    for (int i = 0; i < BENCH_COUNTERS; i++)
+        if (read(fds[i], s->counters + i, sizeof(u64)) != sizeof(u64))
+            s->counted = false;
+#else
+    (void) fds;
+#endif
+}
+
+static inline void bench_report(const char *bench, const char *label,
+    usize n, const struct bench_sample *s)
+{
+    const char *format = getenv("FOX_BENCH_FORMAT");
+    double per = (double) (n ? n : 1);
+
+    if (format == NULL || strcmp(format, "text") == 0) {
+        printf("%-32s %10.2f ns/op", label, (double) s->ns / per);
+        if (s->counted)
+            printf(" %10.2f cyc %10.2f ins",
+                (double) s->counters[BENCH_CYCLES] / per,
+                (double) s->counters[BENCH_INSTRUCTIONS] / per);
+        printf("\n");
+    } else if (strcmp(format, "csv") == 0) {
+        printf("%s,\"%s\",%.3f", bench, label, (double) s->ns / per);
+        for (int i = 0; i < BENCH_COUNTERS; i++) {
+            if (s->counted)
+                printf(",%.3f", (double) s->counters[i] / per);
+            else
+                printf(",");
+        }
+        printf("\n");
+    } else if (strcmp(format, "json") == 0) {
+        printf("{\"bench\":\"%s\",\"label\":\"%s\",\"ns_per_op\":%.3f", bench,
+            label, (double) s->ns / per);
+        for (int i = 0; i < BENCH_COUNTERS; i++) {
+            if (s->counted)
+                printf(",\"%s\":%.3f", bench_counter_names[i],
+                    (double) s->counters[i] / per);
+            else
+                printf(",\"%s\":null", bench_counter_names[i]);
+        }
+        printf("}\n");
+    } else {
+        fprintf(stderr, "bench: unknown FOX_BENCH_FORMAT '%s'\n", format);
+        exit(2);
+    }
+}
+
+/* the name of the program, taken from the file BENCH is used in */
+static inline const char *bench_name(const char *file)
+{
+    static char name[64];
+    const char *base = strrchr(file, '/');
+    usize n;
+
+    base = base ? base + 1 : file;
+    n = strcspn(base, ".");
+    if (n >= sizeof(name))
+        n = sizeof(name) - 1;
+
+    memcpy(name, base, n);
+    name[n] = '\0';
+
+    return name;
+}
+
+#define BENCH(label, n, ...) do {                                           \
+    struct bench_sample _best = { .ns = (u64) -1 }, _sample;                \
+    for (int _round = 0; _round < BENCH_ROUNDS; _round++) {                 \
+        bench_start(&_sample);                                              \
+        __VA_ARGS__;                                                        \
+        bench_stop(&_sample);                                               \
+        if (_sample.ns < _best.ns)                                          \
+            _best = _sample;                                                \
+    }                                                                       \
+    bench_report(bench_name(__FILE__), label, n, &_best);                   \
+    fflush(stdout);                                                         \
+} while (0)
@@ -0,0 +1,63 @@
+#include "bench.h"
+
+#include <deque.h>
+#include <vec.h>
+
+#define N (1 << 14)
+
+/* a FIFO of N jobs, pushed at the back and taken from the front */
+int main()
+{
+    struct fox_vec vec = fox_vec_new(sizeof(u64));
+    struct fox_deque dq = fox_deque_new(sizeof(u64));
+    u64 sum = 0;
+
+    BENCH("fox_vec queue", N, {
+        for (u64 i = 0; i < N; i++)
+            fox_vec_push(&vec, &i);
+        while (vec.size > 0) {
+            sum += *(u64*) fox_vec_front(&vec);
+            fox_vec_remove(&vec, 0, NULL);
+        }
+        bench_use(&sum);
+    });
+
+    BENCH("fox_deque queue", N, {
+        for (u64 i = 0; i < N; i++)
+            fox_deque_push_back(&dq, &i);
+        while (dq.size > 0) {
+            sum += *(u64*) fox_deque_front(&dq);
+            fox_deque_pop_front(&dq, NULL);
+        }
+        bench_use(&sum);
+    });
+
+    /* steady state, one in and one out with N waiting */
+    for (u64 i = 0; i < N; i++) {
+        fox_vec_push(&vec, &i);
+        fox_deque_push_back(&dq, &i);
+    }
+
+    BENCH("fox_vec queue steady", N, {
+        for (u64 i = 0; i < N; i++) {
+            fox_vec_push(&vec, &i);
+            sum += *(u64*) fox_vec_front(&vec);
+            fox_vec_remove(&vec, 0, NULL);
+        }
+        bench_use(&sum);
+    });
+
+    BENCH("fox_deque queue steady", N, {
+        for (u64 i = 0; i < N; i++) {
+            fox_deque_push_back(&dq, &i);
+            sum += *(u64*) fox_deque_front(&dq);
+            fox_deque_pop_front(&dq, NULL);
+        }
+        bench_use(&sum);
+    });
+
+    fox_vec_del(&vec, NULL);
+    fox_deque_del(&dq, NULL);
+
+    return 0;
+}
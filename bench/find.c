@@ -0,0 +1,90 @@
+#include "bench.h"
+
+#include <string.h>
+
+#include <alloc.h>
+#include <vec.h>
+
+#define N 100000
+#define LOOKUPS 1000
+
+static bool equal_u32(const void *a, const void *b)
+{
+    return *(const u32*) a == *(const u32*) b;
+}
+
+static bool le_u32(const void *a, const void *b)
+{
+    return *(const u32*) a <= *(const u32*) b;
+}
+
+/* what fox_vec_find did before, a memcmp per item */
+static isize find_memcmp(const struct fox_vec *vec, const void *needle)
+{
+    const u8 *iter = vec->items;
+
+    for (usize i = 0; i < vec->size; i++, iter += vec->chunksize)
+        if (memcmp(iter, needle, vec->chunksize) == 0)
+            return i;
+
+    return -1;
+}
+
+/* called through a pointer like the library does */
+static comparar *volatile le = le_u32;
+
+static isize bsearch_branchy(const struct fox_vec *vec, const u32 *needle)
+{
+    usize lo = 0, hi = vec->size;
+
+    while (lo < hi) {
+        usize mid = lo + (hi - lo) / 2;
+        u32 *item = fox_vec_get(vec, mid);
+
+        if (!le(needle, item))
+            lo = mid + 1;
+        else if (!le(item, needle))
+            hi = mid;
+        else
+            return mid;
+    }
+
+    return -1;
+}
+
+int main()
+{
+    struct fox_vec vec = fox_vec_new(sizeof(u32));
+    u32 *items = fox_vec_append_uninit(&vec, N);
+    u32 needle = N - 1;
+    isize sink = 0;
+
+    for (u32 i = 0; i < N; i++)
+        items[i] = i;
+
+    BENCH("find memcmp loop, 100k", 1, sink += find_memcmp(&vec, &needle));
+    BENCH("fox_vec_find comparar, 100k", 1,
+        sink += fox_vec_find(&vec, &needle, equal_u32));
+    BENCH("fox_vec_find simd, 100k", 1,
+        sink += fox_vec_find(&vec, &needle, NULL));
+    BENCH("fox_vec_count simd, 100k", 1,
+        sink += fox_vec_count(&vec, &needle, NULL));
+
+    BENCH("binary search branchy", LOOKUPS, {
+        for (u32 i = 0; i < LOOKUPS; i++) {
+            u32 x = i * 2654435761u % N;
+            sink += bsearch_branchy(&vec, &x);
+        }
+    });
+
+    BENCH("fox_vec_bsearch", LOOKUPS, {
+        for (u32 i = 0; i < LOOKUPS; i++) {
+            u32 x = i * 2654435761u % N;
+            sink += fox_vec_bsearch(&vec, &x, le_u32);
+        }
+    });
+
+    bench_use(&sink);
+    fox_vec_del(&vec, NULL);
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "bench.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <vec.h>
+
+#define N (1 << 25)
+
+/*
+ * A vector of N u32 pushed one at a time, so every doubling past the mmap
+ * threshold is a remap under M and H and possibly a copy otherwise. Each
+ * option set runs in a child since fox_alloc_options is read once.
+ */
+static const char *const combinations[] = { "", "M", "H" };
+
+static void run(const char *options)
+{
+    char label[64];
+
+    fox_alloc_options = options;
+    snprintf(label, sizeof(label), "fox_vec_push grow %s",
+        *options ? options : "none");
+    BENCH(label, N, {
+        struct fox_vec vec = fox_vec_new(sizeof(u32));
+        for (u32 i = 0; i < N; i++)
+            fox_vec_push(&vec, &i);
+        bench_use(vec.items);
+        fox_vec_del(&vec, NULL);
+    });
+}
+
+int main()
+{
+    for (usize i = 0; i < sizeof(combinations) / sizeof(*combinations); i++) {
+        pid_t pid = fork();
+        int status;
+
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+
+        if (pid == 0) {
+            run(combinations[i]);
+            _exit(0);
+        }
+
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "fox_vec_push grow '%s' failed\n",
+                combinations[i]);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "bench.h"
+
+#include <map.h>
+
+/* u64 keys spread by a multiplicative step, hits then misses */
+int main()
+{
+    usize sizes[] = { 1000, 1000000 };
+    char label[64];
+    void *found = NULL;
+
+    for (usize i = 0; i < sizeof(sizes) / sizeof(*sizes); i++) {
+        usize n = sizes[i];
+        struct fox_map map = fox_map_new(sizeof(u64), sizeof(u64), NULL,
+            NULL);
+
+        snprintf(label, sizeof(label), "fox_map_insert %lu", n);
+        BENCH(label, n, {
+            fox_map_clear(&map);
+            for (u64 k = 0; k < n; k++) {
+                u64 key = k * 0x9E3779B97F4A7C15ull;
+                fox_map_insert(&map, &key, &k);
+            }
+        });
+
+        snprintf(label, sizeof(label), "fox_map_get hit %lu", n);
+        BENCH(label, n, {
+            for (u64 k = 0; k < n; k++) {
+                u64 key = k * 0x9E3779B97F4A7C15ull;
+                found = fox_map_get(&map, &key);
+                bench_use(found);
+            }
+        });
+
+        snprintf(label, sizeof(label), "fox_map_get miss %lu", n);
+        BENCH(label, n, {
+            for (u64 k = n; k < 2 * n; k++) {
+                u64 key = k * 0x9E3779B97F4A7C15ull;
+                found = fox_map_get(&map, &key);
+                bench_use(found);
+            }
+        });
+
+        snprintf(label, sizeof(label), "fox_map_remove %lu", n);
+        BENCH(label, n, {
+            for (u64 k = 0; k < n; k++) {
+                u64 key = k * 0x9E3779B97F4A7C15ull;
+                fox_map_remove(&map, &key, NULL);
+            }
+            for (u64 k = 0; k < n; k++) {
+                u64 key = k * 0x9E3779B97F4A7C15ull;
+                fox_map_insert(&map, &key, &k);
+            }
+        });
+
+        fox_map_del(&map, NULL, NULL);
+    }
+
+    return 0;
+}
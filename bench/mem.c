@@ -0,0 +1,77 @@
+#include "bench.h"
+
+#include <string.h>
+
+#include <utils.h>
+
+#define BUFFER (1 << 20)
+#define ROUNDS 1000
+
+static u8 buffer[BUFFER + 64];
+
+int main()
+{
+    usize sizes[] = { 16, 100, 1000, 16384, 65536 };
+    char label[64];
+    u32 pattern = 0xF0F0F0F0;
+    int sink = 0;
+
+    for (usize i = 0; i < sizeof(sizes) / sizeof(*sizes); i++) {
+        usize n = sizes[i];
+
+        snprintf(label, sizeof(label), "memmove %lu", n);
+        BENCH(label, ROUNDS, {
+            for (int r = 0; r < ROUNDS; r++)
+                memmove(buffer + 1 + (r & 1), buffer, n);
+        });
+
+        snprintf(label, sizeof(label), "fox_memmove %lu", n);
+        BENCH(label, ROUNDS, {
+            for (int r = 0; r < ROUNDS; r++)
+                fox_memmove(buffer + 1 + (r & 1), buffer, n);
+        });
+
+        snprintf(label, sizeof(label), "fox_rmemcpy %lu", n);
+        BENCH(label, ROUNDS, {
+            for (int r = 0; r < ROUNDS; r++)
+                fox_rmemcpy(buffer + 1 + (r & 1), buffer, n);
+        });
+
+        snprintf(label, sizeof(label), "byte loop fox_rmemcpy was %lu", n);
+        BENCH(label, ROUNDS / 10, {
+            for (int r = 0; r < ROUNDS / 10; r++) {
+                u8 *d = buffer + n + 32, *s = buffer + n;
+                for (usize k = n; k-- > 0;)
+                    *--d = *--s;
+                bench_use(buffer);
+            }
+        });
+
+        snprintf(label, sizeof(label), "memcmp %lu", n);
+        BENCH(label, ROUNDS, {
+            for (int r = 0; r < ROUNDS; r++)
+                sink += memcmp(buffer, buffer + 32, n);
+        });
+
+        snprintf(label, sizeof(label), "fox_memcompare %lu", n);
+        BENCH(label, ROUNDS, {
+            for (int r = 0; r < ROUNDS; r++)
+                sink += fox_memcompare(buffer, buffer + 32, n);
+        });
+
+        snprintf(label, sizeof(label), "fox_memfill u32 %lu", n);
+        BENCH(label, ROUNDS, {
+            for (int r = 0; r < ROUNDS; r++)
+                fox_memfill(buffer, n / 4, &pattern, 4);
+        });
+
+        snprintf(label, sizeof(label), "fox_memfill 12-byte %lu", n);
+        BENCH(label, ROUNDS, {
+            for (int r = 0; r < ROUNDS; r++)
+                fox_memfill(buffer, n / 12, buffer + BUFFER, 12);
+        });
+    }
+
+    bench_use(&sink);
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "bench.h"
+
+#include <string.h>
+
+#include <alloc.h>
+#include <par.h>
+#include <vec.h>
+
+#define N (1 << 22)
+
+static bool le_u32(const void *a, const void *b)
+{
+    return *(const u32*) a <= *(const u32*) b;
+}
+
+static bool eq_u32(const void *a, const void *b)
+{
+    return *(const u32*) a == *(const u32*) b;
+}
+
+static void square(void *data, void *ctx)
+{
+    u32 *x = data;
+
+    (void) ctx;
+    *x = *x * *x;
+}
+
+static void add(void *acc, const void *data)
+{
+    *(u64*) acc += *(const u32*) data;
+}
+
+static void merge(void *acc, const void *data)
+{
+    *(u64*) acc += *(const u64*) data;
+}
+
+static void generate(u32 *items)
+{
+    u32 x = 2463534242u;
+
+    for (u32 i = 0; i < N; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        items[i] = x;
+    }
+}
+
+/* every algorithm on one thread, then on all of them, for the speedup */
+int main()
+{
+    struct fox_vec vec = fox_vec_new(sizeof(u32));
+    u32 *items = fox_vec_append_uninit(&vec, N);
+    usize counts[] = { 1, 0 };
+    char label[64];
+    u64 total;
+    isize found;
+    u32 needle = 0;
+
+    for (usize i = 0; i < sizeof(counts) / sizeof(*counts); i++) {
+        fox_par_threads(counts[i]);
+        usize threads = fox_par_thread_count();
+
+        snprintf(label, sizeof(label), "par_for_each %lu threads", threads);
+        BENCH(label, N, fox_vec_par_for_each(&vec, square, NULL));
+
+        snprintf(label, sizeof(label), "par_reduce %lu threads", threads);
+        BENCH(label, N, {
+            total = 0;
+            fox_vec_par_reduce(&vec, &total, sizeof(total), add, merge);
+            bench_use(&total);
+        });
+
+        /* the needle sits in the last item */
+        generate(items);
+        items[N - 1] = needle = 0xFFFFFFFF;
+        snprintf(label, sizeof(label), "par_find %lu threads", threads);
+        BENCH(label, N, {
+            found = fox_vec_par_find(&vec, &needle, eq_u32);
+            bench_use(&found);
+        });
+
+        snprintf(label, sizeof(label), "par_sort %lu threads", threads);
+        BENCH(label, N, {
+            generate(items);
+            fox_vec_par_sort(&vec, le_u32);
+        });
+    }
+
+    fox_vec_del(&vec, NULL);
+    return 0;
+}
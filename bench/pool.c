@@ -0,0 +1,67 @@
+#include "bench.h"
+
+#include <pool.h>
+
+#define TASKS 100000
+
+struct fib {
+    struct fox_pool *pool;
+    u32 n;
+    u64 result;
+};
+
+static void fib(void *ctx)
+{
+    struct fib *f = ctx;
+
+    if (f->n < 2) {
+        f->result = f->n;
+        return;
+    }
+
+    struct fib a = { f->pool, f->n - 1, 0 }, b = { f->pool, f->n - 2, 0 };
+    struct fox_task *task = fox_pool_spawn(f->pool, fib, &a);
+
+    fib(&b);
+    fox_pool_wait(f->pool, task);
+    f->result = a.result + b.result;
+}
+
+static void nothing(void *ctx)
+{
+    bench_use(ctx);
+}
+
+/* the cost of a task, nested fork/join and a flat batch from outside */
+int main()
+{
+    usize counts[] = { 1, 0 };
+    static struct fox_task *tasks[TASKS];
+    char label[64];
+
+    for (usize i = 0; i < sizeof(counts) / sizeof(*counts); i++) {
+        struct fox_pool *pool = fox_pool_new(counts[i]);
+        usize threads = fox_pool_threads(pool);
+
+        /* fib(25) spawns 121392 tasks */
+        snprintf(label, sizeof(label), "fork/join fib %lu threads", threads);
+        BENCH(label, 121392, {
+            struct fib f = { pool, 25, 0 };
+            fib(&f);
+            bench_use(&f);
+        });
+
+        snprintf(label, sizeof(label), "spawn from outside %lu threads",
+            threads);
+        BENCH(label, TASKS, {
+            for (usize k = 0; k < TASKS; k++)
+                tasks[k] = fox_pool_spawn(pool, nothing, NULL);
+            for (usize k = 0; k < TASKS; k++)
+                fox_pool_wait(pool, tasks[k]);
+        });
+
+        fox_pool_del(pool);
+    }
+
+    return 0;
+}
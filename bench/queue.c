@@ -0,0 +1,209 @@
+#include "bench.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <queue.h>
+#include <vec.h>
+
+#define N (1 << 18)
+#define BATCH 32
+
+/*
+ * Throughput of records of 16 bytes from producers to consumers, n is the
+ * number of records. The mutex-guarded fox_vec is used as a stack, its
+ * cheapest end, with consumers yielding while it is empty.
+ */
+struct record {
+    u64 seq;
+    u64 payload;
+};
+
+struct run {
+    usize producers;
+    usize consumers;
+    bool batch;
+    struct fox_spsc *spsc;
+    struct fox_mpmc *mpmc;
+    struct fox_vec vec;
+    pthread_mutex_t lock;
+};
+
+static void *spsc_producer(void *arg)
+{
+    struct run *r = arg;
+    struct record batch[BATCH];
+
+    for (u64 i = 0; i < N; i += BATCH) {
+        for (u64 k = 0; k < BATCH; k++)
+            batch[k] = (struct record) { i + k, k };
+        if (r->batch) {
+            fox_spsc_push_n(r->spsc, batch, BATCH);
+        } else {
+            for (u64 k = 0; k < BATCH; k++)
+                fox_spsc_push(r->spsc, batch + k);
+        }
+    }
+
+    return NULL;
+}
+
+static void *spsc_consumer(void *arg)
+{
+    struct run *r = arg;
+    struct record batch[BATCH];
+    u64 sum = 0;
+
+    for (u64 i = 0; i < N; i += BATCH) {
+        if (r->batch) {
+            fox_spsc_pop_n(r->spsc, batch, BATCH);
+        } else {
+            for (u64 k = 0; k < BATCH; k++)
+                fox_spsc_pop(r->spsc, batch + k);
+        }
+        sum += batch[0].seq;
+    }
+
+    bench_use(&sum);
+    return NULL;
+}
+
+static void *mpmc_producer(void *arg)
+{
+    struct run *r = arg;
+    struct record batch[BATCH];
+
+    for (u64 i = 0; i < N / r->producers; i += BATCH) {
+        for (u64 k = 0; k < BATCH; k++)
+            batch[k] = (struct record) { i + k, k };
+        if (r->batch) {
+            fox_mpmc_push_n(r->mpmc, batch, BATCH);
+        } else {
+            for (u64 k = 0; k < BATCH; k++)
+                fox_mpmc_push(r->mpmc, batch + k);
+        }
+    }
+
+    return NULL;
+}
+
+static void *mpmc_consumer(void *arg)
+{
+    struct run *r = arg;
+    struct record batch[BATCH];
+    u64 sum = 0;
+
+    for (u64 i = 0; i < N / r->consumers; i += BATCH) {
+        if (r->batch) {
+            fox_mpmc_pop_n(r->mpmc, batch, BATCH);
+        } else {
+            for (u64 k = 0; k < BATCH; k++)
+                fox_mpmc_pop(r->mpmc, batch + k);
+        }
+        sum += batch[0].seq;
+    }
+
+    bench_use(&sum);
+    return NULL;
+}
+
+static void *vec_producer(void *arg)
+{
+    struct run *r = arg;
+
+    for (u64 i = 0; i < N / r->producers; i++) {
+        struct record rec = { i, 0 };
+
+        pthread_mutex_lock(&r->lock);
+        fox_vec_push(&r->vec, &rec);
+        pthread_mutex_unlock(&r->lock);
+    }
+
+    return NULL;
+}
+
+static void *vec_consumer(void *arg)
+{
+    struct run *r = arg;
+    u64 sum = 0;
+
+    for (u64 i = 0; i < N / r->consumers;) {
+        struct record rec;
+        bool got = false;
+
+        pthread_mutex_lock(&r->lock);
+        if (r->vec.size > 0) {
+            rec = *(struct record*) fox_vec_back(&r->vec);
+            fox_vec_pop(&r->vec, NULL);
+            got = true;
+        }
+        pthread_mutex_unlock(&r->lock);
+
+        if (!got) {
+            sched_yield();
+            continue;
+        }
+
+        sum += rec.seq;
+        i++;
+    }
+
+    bench_use(&sum);
+    return NULL;
+}
+
+static void run(struct run *r, void *(*producer)(void*),
+    void *(*consumer)(void*))
+{
+    pthread_t threads[8];
+    usize count = 0;
+
+    for (usize i = 0; i < r->consumers; i++)
+        pthread_create(threads + count++, NULL, consumer, r);
+    for (usize i = 0; i < r->producers; i++)
+        pthread_create(threads + count++, NULL, producer, r);
+    for (usize i = 0; i < count; i++)
+        pthread_join(threads[i], NULL);
+}
+
+int main()
+{
+    struct run r = { 1, 1, false, NULL, NULL,
+        fox_vec_new(sizeof(struct record)), PTHREAD_MUTEX_INITIALIZER };
+    usize shapes[][2] = { { 1, 1 }, { 2, 2 }, { 4, 4 } };
+    char label[64];
+
+    r.spsc = fox_spsc_new(sizeof(struct record), 1024);
+    r.mpmc = fox_mpmc_new(sizeof(struct record), 1024);
+
+    r.batch = false;
+    BENCH("fox_spsc 1p1c", N, run(&r, spsc_producer, spsc_consumer));
+    r.batch = true;
+    BENCH("fox_spsc 1p1c batch 32", N,
+        run(&r, spsc_producer, spsc_consumer));
+
+    for (usize i = 0; i < sizeof(shapes) / sizeof(*shapes); i++) {
+        r.producers = shapes[i][0];
+        r.consumers = shapes[i][1];
+
+        r.batch = false;
+        snprintf(label, sizeof(label), "fox_mpmc %lup%luc", r.producers,
+            r.consumers);
+        BENCH(label, N, run(&r, mpmc_producer, mpmc_consumer));
+
+        r.batch = true;
+        snprintf(label, sizeof(label), "fox_mpmc %lup%luc batch 32",
+            r.producers, r.consumers);
+        BENCH(label, N, run(&r, mpmc_producer, mpmc_consumer));
+
+        snprintf(label, sizeof(label), "mutex fox_vec %lup%luc", r.producers,
+            r.consumers);
+        BENCH(label, N, run(&r, vec_producer, vec_consumer));
+    }
+
+    fox_spsc_del(r.spsc, NULL);
+    fox_mpmc_del(r.mpmc, NULL);
+    fox_vec_del(&r.vec, NULL);
+
+    return 0;
+}
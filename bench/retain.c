@@ -0,0 +1,52 @@
+#include "bench.h"
+
+#include <alloc.h>
+#include <vec.h>
+
+#define N (1 << 16)
+
+static bool keep(const void *a)
+{
+    return *(const u32*) a % 4 != 0;
+}
+
+static void fill(struct fox_vec *vec)
+{
+    vec->size = 0;
+    u32 *items = fox_vec_append_uninit(vec, N);
+
+    for (u32 i = 0; i < N; i++)
+        items[i] = i;
+}
+
+int main()
+{
+    struct fox_vec vec = fox_vec_new(sizeof(u32));
+
+    /* drops every fourth item */
+    BENCH("fox_vec_remove in a loop", N, {
+        fill(&vec);
+        for (usize i = vec.size; i-- > 0;)
+            if (!keep(fox_vec_get(&vec, i)))
+                fox_vec_remove(&vec, i, NULL);
+    });
+
+    BENCH("fox_vec_retain", N, {
+        fill(&vec);
+        fox_vec_retain(&vec, keep, NULL);
+    });
+
+    BENCH("fox_vec_remove front quarter", N, {
+        fill(&vec);
+        for (usize i = 0; i < N / 4; i++)
+            fox_vec_remove(&vec, 0, NULL);
+    });
+
+    BENCH("fox_vec_remove_range front quarter", N, {
+        fill(&vec);
+        fox_vec_remove_range(&vec, 0, N / 4, NULL);
+    });
+
+    fox_vec_del(&vec, NULL);
+    return 0;
+}
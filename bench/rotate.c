@@ -0,0 +1,57 @@
+#include "bench.h"
+
+#include <string.h>
+
+#include <alloc.h>
+#include <utils.h>
+#include <vec.h>
+
+#define N (1 << 20)
+
+/* the previous fox_vec_rotate, with its stack buffer sized correctly */
+static void rotate_copy(struct fox_vec *vec, const isize rotation)
+{
+    u8 *iter = vec->items;
+
+    if (rotation < 0) {
+        u8 data_buffer[vec->chunksize * (-rotation)];
+        memcpy(data_buffer, iter, vec->chunksize * (-rotation));
+        memcpy(iter, iter + (-rotation) * vec->chunksize,
+            (vec->size - (-rotation)) * vec->chunksize);
+        memcpy(iter + (vec->size - (-rotation)) * vec->chunksize,
+            data_buffer, vec->chunksize * (-rotation));
+    } else if (rotation > 0) {
+        u8 data_buffer[vec->chunksize * rotation];
+        memcpy(data_buffer, iter + (vec->size - rotation) * vec->chunksize,
+            vec->chunksize * rotation);
+        fox_rmemcpy(iter + rotation * vec->chunksize, iter,
+            (vec->size - rotation) * vec->chunksize);
+        memcpy(iter, data_buffer, vec->chunksize * rotation);
+    }
+}
+
+int main()
+{
+    struct fox_vec vec = fox_vec_new(sizeof(u32));
+    fox_vec_append_uninit(&vec, N);
+    memset(vec.items, 1, N * sizeof(u32));
+
+    /* rotations up to a few thousand items, the old one kept them on stack */
+    isize rotations[] = { 1, -1, 1000, -1000, 4096 };
+    char label[64];
+
+    for (usize i = 0; i < sizeof(rotations) / sizeof(*rotations); i++) {
+        snprintf(label, sizeof(label), "stack copy rotate %ld", rotations[i]);
+        BENCH(label, N, rotate_copy(&vec, rotations[i]));
+
+        snprintf(label, sizeof(label), "fox_vec_rotate %ld", rotations[i]);
+        BENCH(label, N, fox_vec_rotate(&vec, rotations[i]));
+    }
+
+    BENCH("fox_vec_rotate N / 3", N, fox_vec_rotate(&vec, N / 3));
+    BENCH("fox_vec_rotate_range half", N / 2,
+        fox_vec_rotate_range(&vec, N / 4, N / 4 * 3, 12345));
+
+    fox_vec_del(&vec, NULL);
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include "bench.h"
+
+#include <alloc.h>
+#include <vec.h>
+
+#define N (1 << 20)
+
+/* the common case on a request path, a vector that never holds more than 3 */
+int main()
+{
+    BENCH("fox_vec_new 3 items", N, {
+        for (int i = 0; i < N; i++) {
+            struct fox_vec vec = fox_vec_new(sizeof(int));
+            for (int j = 0; j < 3; j++)
+                fox_vec_push(&vec, &j);
+            bench_use(vec.items);
+            fox_vec_del(&vec, NULL);
+        }
+    });
+
+    BENCH("FOX_VEC_INLINE 3 items", N, {
+        for (int i = 0; i < N; i++) {
+            struct fox_vec vec = FOX_VEC_INLINE(int, 4);
+            for (int j = 0; j < 3; j++)
+                fox_vec_push(&vec, &j);
+            bench_use(vec.items);
+            fox_vec_del(&vec, NULL);
+        }
+    });
+
+    BENCH("FOX_VEC_INLINE spill at 5", N, {
+        for (int i = 0; i < N; i++) {
+            struct fox_vec vec = FOX_VEC_INLINE(int, 4);
+            for (int j = 0; j < 5; j++)
+                fox_vec_push(&vec, &j);
+            bench_use(vec.items);
+            fox_vec_del(&vec, NULL);
+        }
+    });
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <alloc.h>
+#include <vec.h>
+
+#define N (1 << 20)
+
+static bool le_u32(const void *a, const void *b)
+{
+    return *(const u32*) a <= *(const u32*) b;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    u32 x = *(const u32*) a, y = *(const u32*) b;
+    return (x > y) - (x < y);
+}
+
+static u64 key_u32(const void *a)
+{
+    return *(const u32*) a;
+}
+
+static u32 inputs[3][N];
+
+static void generate(void)
+{
+    u32 x = 2463534242u;
+
+    for (u32 i = 0; i < N; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+
+        inputs[0][i] = x;
+        inputs[1][i] = i;
+        inputs[2][i] = x % 16;
+    }
+}
+
+/* the copy is timed too, it costs about a nanosecond per item */
+static void fill(struct fox_vec *vec, usize pattern)
+{
+    memcpy(vec->items, inputs[pattern], sizeof(inputs[pattern]));
+}
+
+int main()
+{
+    const char *patterns[] = { "random", "sorted", "few" };
+    char label[64];
+
+    generate();
+
+    struct fox_vec vec = fox_vec_new(sizeof(u32));
+    fox_vec_append_uninit(&vec, N);
+
+    for (usize p = 0; p < 3; p++) {
+        snprintf(label, sizeof(label), "qsort %s", patterns[p]);
+        BENCH(label, N, {
+            fill(&vec, p);
+            qsort(vec.items, N, sizeof(u32), compare_u32);
+        });
+
+        snprintf(label, sizeof(label), "fox_vec_sort %s", patterns[p]);
+        BENCH(label, N, {
+            fill(&vec, p);
+            fox_vec_sort(&vec, le_u32);
+        });
+
+        snprintf(label, sizeof(label), "fox_vec_stable_sort %s", patterns[p]);
+        BENCH(label, N, {
+            fill(&vec, p);
+            fox_vec_stable_sort(&vec, le_u32);
+        });
+
+        snprintf(label, sizeof(label), "fox_vec_sort_by_key %s", patterns[p]);
+        BENCH(label, N, {
+            fill(&vec, p);
+            fox_vec_sort_by_key(&vec, key_u32);
+        });
+    }
+
+    fox_vec_del(&vec, NULL);
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "bench.h"
+
+#include <str.h>
+#include <vec.h>
+
+#define N (1 << 16)
+
+/* building strings byte by byte and a piece at a time, then searching */
+int main()
+{
+    static char text[N + 1];
+    u32 state = 2463534242u;
+
+    /* words of a 4-letter alphabet, so first bytes match often */
+    for (usize i = 0; i < N; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        text[i] = state % 8 == 0 ? ',' : "acgt"[state % 4];
+    }
+
+    BENCH("fox_vec push per byte", N, {
+        struct fox_vec vec = fox_vec_new(sizeof(char));
+        for (usize i = 0; i < N; i++)
+            fox_vec_push(&vec, text + i);
+        bench_use(vec.items);
+        fox_vec_del(&vec, NULL);
+    });
+
+    BENCH("fox_str_push per byte", N, {
+        struct fox_str s = fox_str_new();
+        for (usize i = 0; i < N; i++)
+            fox_str_push(&s, text[i]);
+        bench_use(&s);
+        fox_str_del(&s);
+    });
+
+    BENCH("fox_str_appendf", 4096, {
+        struct fox_str s = fox_str_new();
+        for (int i = 0; i < 4096; i++)
+            fox_str_appendf(&s, "%d,", i);
+        bench_use(&s);
+        fox_str_del(&s);
+    });
+
+    /* short strings never leave the struct */
+    BENCH("fox_str short", 4096, {
+        for (int i = 0; i < 4096; i++) {
+            struct fox_str s = fox_str_from("key-");
+            fox_str_appendf(&s, "%d", i);
+            bench_use(&s);
+            fox_str_del(&s);
+        }
+    });
+
+    struct fox_str_view hay = { text, N };
+    /* common first and last bytes, but not in the text */
+    const char *needle = "acgtacgtacgtacgta";
+    isize found = 0;
+
+    text[N - 8] = 0;
+    BENCH("strstr", N, {
+        found = strstr(text, needle) != NULL;
+        bench_use(&found);
+    });
+
+    BENCH("fox_str_view_find", N, {
+        found = fox_str_view_find(hay, fox_str_view_of(needle));
+        bench_use(&found);
+    });
+
+    BENCH("fox_str_view_split", N, {
+        struct fox_str_view rest = hay, piece;
+        usize pieces = 0;
+        while (fox_str_view_split(&rest, fox_str_view_of(","), &piece))
+            pieces++;
+        bench_use(&pieces);
+    });
+
+    return 0;
+}
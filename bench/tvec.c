@@ -0,0 +1,98 @@
+#include "bench.h"
+
+#include <alloc.h>
+#include <vec.h>
+#include <tvec.h>
+
+FOX_VEC_DEFINE(u64s, u64)
+
+struct point {
+    i32 x, y, z;
+};
+
+FOX_VEC_DEFINE(points, struct point)
+
+#define N (1 << 20)
+
+static void bench_u64(void)
+{
+    u64 sum = 0;
+
+    BENCH("fox_vec push u64", N, {
+        struct fox_vec vec = fox_vec_new(sizeof(u64));
+        for (u64 i = 0; i < N; i++)
+            fox_vec_push(&vec, &i);
+        bench_use(vec.items);
+        fox_vec_del(&vec, NULL);
+    });
+
+    BENCH("u64s_push", N, {
+        struct u64s vec = u64s_new();
+        for (u64 i = 0; i < N; i++)
+            u64s_push(&vec, i);
+        bench_use(vec.items);
+        u64s_del(&vec, NULL);
+    });
+
+    struct fox_vec generic = fox_vec_new(sizeof(u64));
+    for (u64 i = 0; i < N; i++)
+        fox_vec_push(&generic, &i);
+
+    struct u64s typed = u64s_from_vec(generic);
+
+    BENCH("fox_vec get u64", N, {
+        for (usize i = 0; i < N; i++)
+            sum += *(u64*) fox_vec_get(&generic, i);
+        bench_use(&sum);
+    });
+
+    BENCH("u64s_at", N, {
+        for (usize i = 0; i < N; i++)
+            sum += u64s_at(&typed, i);
+        bench_use(&sum);
+    });
+
+    u64 needle = N - 1;
+
+    BENCH("fox_vec find u64", N, {
+        isize at = fox_vec_find(&generic, &needle, NULL);
+        bench_use(&at);
+    });
+
+    BENCH("u64s_find", N, {
+        isize at = u64s_find(&typed, needle, NULL);
+        bench_use(&at);
+    });
+
+    fox_vec_del(&generic, NULL);
+}
+
+static void bench_points(void)
+{
+    BENCH("fox_vec push point", N, {
+        struct fox_vec vec = fox_vec_new(sizeof(struct point));
+        for (i32 i = 0; i < N; i++) {
+            struct point p = { i, -i, i * 2 };
+            fox_vec_push(&vec, &p);
+        }
+        bench_use(vec.items);
+        fox_vec_del(&vec, NULL);
+    });
+
+    BENCH("points_push", N, {
+        struct points vec = points_new();
+        for (i32 i = 0; i < N; i++) {
+            struct point p = { i, -i, i * 2 };
+            points_push(&vec, p);
+        }
+        bench_use(vec.items);
+        points_del(&vec, NULL);
+    });
+}
+
+int main()
+{
+    bench_u64();
+    bench_points();
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "bench.h"
+
+#include <string.h>
+
+#include <alloc.h>
+#include <vec.h>
+
+#define INSERTS 1000
+
+/* the hot fox_vec paths over a few sizes and item widths */
+int main()
+{
+    usize sizes[] = { 1000, 100000 };
+    usize chunks[] = { 4, 16, 64 };
+    u8 item[64] = {0}, needle[64];
+    char label[64];
+    isize found;
+
+    memset(needle, 0xFF, sizeof(needle));
+
+    for (usize c = 0; c < sizeof(chunks) / sizeof(*chunks); c++) {
+        usize chunk = chunks[c];
+
+        for (usize s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+            usize n = sizes[s];
+
+            snprintf(label, sizeof(label), "fox_vec_push %lu x%lu", n, chunk);
+            BENCH(label, n, {
+                struct fox_vec vec = fox_vec_new(chunk);
+                for (usize i = 0; i < n; i++)
+                    fox_vec_push(&vec, item);
+                bench_use(vec.items);
+                fox_vec_del(&vec, NULL);
+            });
+
+            struct fox_vec vec = fox_vec_new(chunk);
+            fox_vec_append_uninit(&vec, n);
+            memset(vec.items, 0, n * chunk);
+
+            snprintf(label, sizeof(label), "fox_vec_insert %lu x%lu", n,
+                chunk);
+            BENCH(label, INSERTS, {
+                for (usize i = 0; i < INSERTS; i++)
+                    fox_vec_insert(&vec, n / 2, item);
+                vec.size = n;
+            });
+
+            snprintf(label, sizeof(label), "fox_vec_find %lu x%lu", n, chunk);
+            BENCH(label, n, {
+                found = fox_vec_find(&vec, needle, NULL);
+                bench_use(&found);
+            });
+
+            snprintf(label, sizeof(label), "fox_vec_rotate %lu x%lu", n,
+                chunk);
+            BENCH(label, n, fox_vec_rotate(&vec, n / 3));
+
+            fox_vec_del(&vec, NULL);
+        }
+    }
+
+    return 0;
+}
@@ -9,36 +9,105 @@ struct foxptr {
 
 /*
  * C    “Canaries”. Add canaries at the end of allocations in order to detect
- *      heap overflows.
+ *      heap overflows. They are 100 bytes long unless a size follows the
+ *      letter (C32). Canaries are checked on every free, follow the option
+ *      with - (C-, C32-) to only check them through fox_check_all.
  *
- * D    "Dump". Foxstd will dump a leak report at exit into a file, this option
- *      can be followed with + to dump memory content
+ * D    "Dump". Foxstd will dump a leak report at exit into memdump.foxstd,
+ *      this option can be followed with + to dump memory content. The format
+ *      is described in dump.h, fox_alloc_snapshot writes the same report at
+ *      any time.
  *
  * F    "Freecheck". Enable more extensive double free detection.
  *
+ * H    "Huge pages". As M, and ask the kernel to back the mappings with
+ *      transparent huge pages.
+ *
+ * M    "Mmap". Give allocations of 1 MiB and more a mapping of their own, a
+ *      different byte threshold can follow the letter (M65536). Growing them
+ *      moves their pages with mremap instead of copying them, and freeing
+ *      them gives the memory back to the system at once.
+ *
+ * P    "Profile". Sample about one allocation every 512 KiB and record its
+ *      call stack, a different byte interval can follow the letter (P65536).
+ *      A heap profile of live and total bytes per call site is written to
+ *      heapprof.foxstd at exit, or anywhere with fox_alloc_profile.
+ *
  * Q    "Quiet". Foxstd will not make the data "scream" and won't show warning
  *      when dumping the memory content as well
  *
+ * S    "Slab". Serve small allocations from per-thread size-class caches
+ *      instead of calling malloc for each of them. The caches are refilled in
+ *      batches from memory obtained through fox_set_malloc.
+ *
  * V    "Verbose". Foxstd will print every information during runtime.
  *
  * X    "xmalloc". Rather than return failure, abort the program with a
  *      diagnostic message on stderr.
  *
+ * Numbers after C, M and P are taken as given, 0 included: C0 adds empty
+ * canaries, M0 maps every allocation and P0 samples every allocation.
+ *
  * Options can be combined
  */
 extern const char *fox_alloc_options;
 
+#define FOX_ALLOC_BUCKETS 32
+
+/*
+ * Allocator counters, always kept and cheap enough to read every second.
+ * histogram[i] counts allocations of i significant bits, so sizes in
+ * [2^(i-1), 2^i), the last bucket takes everything larger. peak_bytes may
+ * trail the true peak by up to 64 KiB per thread.
+ */
+struct fox_alloc_stats {
+    usize live_bytes;
+    usize peak_bytes;
+    usize allocs;
+    usize frees;
+    usize reallocs_grown;   /* resized at the same address */
+    usize reallocs_moved;   /* at a new address, copied or remapped */
+    usize histogram[FOX_ALLOC_BUCKETS];
+};
+
 void*   fox_alloc(usize size);
 void*   fox_realloc(void *ptr, usize new_size);
 void*   fox_recalloc(void *ptr, usize new_size);
 void    fox_free(void *ptr);
 
+/*
+ * alignment must be a power of two no larger than the page size. The block
+ * keeps its alignment when it is later resized with fox_realloc.
+ */
+void*   fox_alloc_aligned(usize size, usize alignment);
+void*   fox_realloc_aligned(void *ptr, usize new_size, usize alignment);
+
+/*
+ * Makes an allocation out of size bytes of caller storage, a stack array or
+ * a struct member, for buffers that rarely outgrow it. FOX_INLINE_SIZE(n)
+ * bytes hold n bytes of data. fox_realloc keeps the block in buf while it
+ * fits and copies it to a regular allocation once it does not, fox_free does
+ * nothing until then. Such blocks are not tracked, counted or given canaries
+ * and buf must outlive them. Returns NULL when buf cannot hold the header.
+ */
+#define FOX_INLINE_SIZE(n)  ((n) + sizeof(usize) + sizeof(struct foxptr) + 15)
+
+void*   fox_alloc_inline(void *buf, usize size);
+
 void*   fox_reallocarray(void *ptr, usize new_nmemb, usize size);
 void*   fox_recallocarray(void *ptr, usize new_nmemb, usize size);
 
 void*   fox_alloczero(usize size);
+/* zeroes the data of the block, not its header, then frees it */
 void    fox_freezero(void *ptr);
 bool    fox_check(void *ptr);
+/* checks the canary of every live block, needs the C and F or D options */
+bool    fox_check_all();
+bool    fox_alloc_profile(const char *path);
+/* needs the F or D option, returns false otherwise */
+bool    fox_alloc_snapshot(const char *path);
+
+struct fox_alloc_stats fox_alloc_stats();
 
 #define fox_visualize(ptr) ((struct foxptr*) (((u8*) ptr) - sizeof(usize)))
 usize   fox_allocated(void *ptr);
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <num.h>
+
+/*
+ * Region allocator. Allocations are bumped out of large blocks and released
+ * all at once with fox_arena_reset or fox_arena_del, or back to a mark taken
+ * with fox_arena_save. Pointers returned by an arena are regular fox
+ * allocations: fox_allocated, fox_check and fox_realloc work on them, the C
+ * and D options of fox_alloc_options apply, and fox_free only gives the
+ * memory back when it was the last allocation of the arena.
+ *
+ * An arena must not be shared between threads without external locking.
+ */
+struct fox_arena;
+
+struct fox_arena_mark {
+    void *block;
+    usize used;
+    usize count;
+    usize bytes;
+};
+
+struct fox_arena       *fox_arena_new(usize block_size);
+void                    fox_arena_del(struct fox_arena *arena);
+void*                   fox_arena_alloc(struct fox_arena *arena, usize size);
+void*                   fox_arena_alloczero(struct fox_arena *arena,
+                            usize size);
+void                    fox_arena_reset(struct fox_arena *arena);
+struct fox_arena_mark   fox_arena_save(const struct fox_arena *arena);
+void                    fox_arena_restore(struct fox_arena *arena,
+                            struct fox_arena_mark mark);
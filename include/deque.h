@@ -0,0 +1,45 @@
+#pragma once
+
+#include <num.h>
+#include <fns.h>
+#include <alloc.h>
+
+/*
+ * Double ended queue of chunksize items in a ring buffer, pushing and
+ * popping at either end never shifts the other items. Capacity is a power
+ * of two and doubles when full, the items keep their order by index.
+ * Pointers to items stay valid until the next push.
+ *
+ *      struct fox_deque dq = fox_deque_new(sizeof(struct job));
+ *      fox_deque_push_back(&dq, &job);
+ *      struct job *next = fox_deque_front(&dq);
+ *      fox_deque_pop_front(&dq, NULL);
+ */
+struct fox_deque {
+    const usize chunksize;
+    usize size;
+    /* private */
+    void *items;
+    usize head;     /* slot of the front item */
+    usize capacity;
+};
+
+struct fox_deque    fox_deque_new(const usize chunksize);
+void                fox_deque_del(struct fox_deque *dq, deletor *deletor);
+void                fox_deque_push_back(struct fox_deque *dq,
+                        const void *data);
+void                fox_deque_push_front(struct fox_deque *dq,
+                        const void *data);
+void                fox_deque_pop_back(struct fox_deque *dq,
+                        deletor *deletor);
+void                fox_deque_pop_front(struct fox_deque *dq,
+                        deletor *deletor);
+void*               fox_deque_front(const struct fox_deque *dq);
+void*               fox_deque_back(const struct fox_deque *dq);
+/* index 0 is the front */
+void*               fox_deque_get(const struct fox_deque *dq,
+                        const usize index);
+void                fox_deque_clear(struct fox_deque *dq, deletor *deletor);
+void                fox_deque_reserve(struct fox_deque *dq,
+                        const usize capacity);
+bool                fox_deque_is_empty(const struct fox_deque *dq);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <num.h>
+
+/*
+ * Leak report written by the D option and fox_alloc_snapshot, in native
+ * byte order:
+ *
+ *      [header][content of the blocks...][index]
+ *
+ * index holds one entry per live block, sorted by address. Contents are only
+ * written with D+, offset is then where the block content starts in the
+ * file, 0 otherwise. Contents are padded so the index is 8 byte aligned.
+ */
+#define FOX_DUMP_MAGIC      "FOXDUMP"
+#define FOX_DUMP_VERSION    2
+
+#define FOX_DUMP_CONTENT    (1 << 0)
+
+struct fox_dump_header {
+    char magic[8];
+    u32 version;
+    u32 flags;
+    u64 count;
+    u64 index;      /* file offset of the index */
+};
+
+struct fox_dump_entry {
+    u64 address;
+    u64 size;
+    u64 offset;
+    u32 screaming;  /* still filled with 0xAA, never written to */
+    u32 reserved;
+};
@@ -4,3 +4,14 @@
 
 typedef void deletor(void *data);
 typedef bool comparar(const void *a, const void *b);
+typedef bool predicate(const void *data);
+/* integer sort key of an item, for radix sorts */
+typedef u64 keyof(const void *data);
+/* called on every item, ctx is passed through untouched */
+typedef void visitor(void *data, void *ctx);
+/* folds data into the accumulator acc */
+typedef void folder(void *acc, const void *data);
+/* a unit of work handed to another thread */
+typedef void runnable(void *ctx);
+/* hash of a map key */
+typedef u64 hasher(const void *key);
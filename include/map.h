@@ -0,0 +1,68 @@
+#pragma once
+
+#include <num.h>
+#include <fns.h>
+
+/*
+ * Open addressing hash map with keys and values of runtime sizes, copied in
+ * like the items of a fox_vec. The layout is that of a Swiss table: every
+ * slot has a control byte holding 7 bits of its hash, and a lookup compares
+ * a group of 16 of them at once with SSE2 before it touches any key.
+ * Capacity is a power of two, at most 7/8 of it is used.
+ *
+ * hash defaults to a hash of the key bytes, equals to memcmp. Pointers to
+ * keys and values stay valid until the next insert or remove.
+ *
+ *      struct fox_map map = fox_map_new(sizeof(int), sizeof(double), NULL,
+ *          NULL);
+ *      fox_map_insert(&map, &key, &value);
+ *      double *found = fox_map_get(&map, &key);
+ *
+ *      void *k, *v;
+ *      for (usize it = 0; fox_map_next(&map, &it, &k, &v);)
+ *          ...
+ */
+struct fox_map {
+    const usize keysize;
+    const usize valuesize;
+    usize size;
+    usize capacity;
+    /* private */
+    u8 *ctrl;
+    u8 *slots;
+    usize stride;   /* bytes per slot, key then value */
+    usize offset;   /* of the value in a slot */
+    usize growth;   /* inserts left before a rehash */
+    hasher *hash;
+    comparar *equals;
+    bool raw;
+};
+
+struct fox_map  fox_map_new(const usize keysize, const usize valuesize,
+                    hasher *hash, comparar *equals);
+void            fox_map_del(struct fox_map *map, deletor *key_deletor,
+                    deletor *value_deletor);
+/* room for count entries without a rehash */
+bool            fox_map_reserve(struct fox_map *map, const usize count);
+/*
+ * Copies key and value in, replacing the value of an equal key. Returns
+ * where the value is kept, NULL when the memory cannot be had. value may be
+ * NULL to fill it through the returned pointer instead.
+ */
+void*           fox_map_insert(struct fox_map *map, const void *key,
+                    const void *value);
+/* the value of key, NULL when it is missing */
+void*           fox_map_get(const struct fox_map *map, const void *key);
+bool            fox_map_contains(const struct fox_map *map, const void *key);
+/* copies the value out unless value is NULL, false when key is missing */
+bool            fox_map_remove(struct fox_map *map, const void *key,
+                    void *value);
+void            fox_map_clear(struct fox_map *map);
+/*
+ * Walks the entries in no particular order, it starts at 0. Inserting or
+ * removing while walking may skip entries or see them twice.
+ */
+bool            fox_map_next(const struct fox_map *map, usize *it,
+                    void **key, void **value);
+/* the default hash */
+u64             fox_hash(const void *data, usize size);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <num.h>
+#include <fns.h>
+#include <vec.h>
+
+/*
+ * Parallel algorithms over fox_vec. The items are cut into chunks of whole
+ * cache lines whose layout depends only on the vector, never on the number
+ * of threads. The chunks are run as fox_pool tasks on a pool shared by all
+ * of them, callbacks may call these functions again.
+ *
+ * fox_par_threads sets the number of threads taking part, the caller
+ * included. 0, the default, means one per online CPU. It must not be called
+ * while a parallel algorithm is running.
+ */
+void            fox_par_threads(const usize threads);
+usize           fox_par_thread_count(void);
+
+void            fox_vec_par_for_each(struct fox_vec *vec, visitor *visit,
+                    void *ctx);
+/*
+ * result holds size bytes, the identity of fold on entry and the reduction
+ * on return. Every chunk is folded from its own copy of the identity and the
+ * chunks are merged into result in order, so a non-associative fold such as
+ * a floating point sum gives the same result on any number of threads.
+ */
+void            fox_vec_par_reduce(const struct fox_vec *vec, void *result,
+                    const usize size, folder *fold, folder *merge);
+/*
+ * The lowest index as with fox_vec_find, chunks past an item already found
+ * stop early.
+ */
+isize           fox_vec_par_find(const struct fox_vec *vec,
+                    const void *needle, comparar *comparar);
+/*
+ * A stable merge sort, comparar as in fox_vec_stable_sort. Needs room for a
+ * copy of the items and sorts on the calling thread if it cannot get it.
+ */
+void            fox_vec_par_sort(struct fox_vec *vec, comparar *comparar);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <num.h>
+#include <fns.h>
+
+/*
+ * Work-stealing thread pool. Every worker owns a Chase-Lev deque, it pushes
+ * and pops the tasks it spawns at the bottom while idle workers steal from
+ * the top of the others, so there is no queue shared by all of them. Tasks
+ * spawned from threads outside the pool are pushed on a lock-free stack the
+ * workers drain into their deques.
+ *
+ * fox_pool_wait runs other tasks until the one it waits for is done, which
+ * lets tasks fork and join to any depth:
+ *
+ *      struct fox_task *right = fox_pool_spawn(pool, sum, &upper);
+ *      sum(&lower);
+ *      fox_pool_wait(pool, right);
+ *
+ * Every task returned by fox_pool_spawn must be waited for exactly once,
+ * its memory comes from fox_alloc and is kept by the worker that waited for
+ * it for its next spawn.
+ */
+struct fox_pool;
+struct fox_task;
+
+/* threads workers, or one per online CPU when 0 */
+struct fox_pool *fox_pool_new(const usize threads);
+/* every task must have been waited for */
+void            fox_pool_del(struct fox_pool *pool);
+usize           fox_pool_threads(const struct fox_pool *pool);
+/*
+ * Runs run(ctx) on the pool, or right away on the calling thread when there
+ * is no memory for the task, NULL is then returned.
+ */
+struct fox_task *fox_pool_spawn(struct fox_pool *pool, runnable *run,
+                    void *ctx);
+/* returns at once for NULL */
+void            fox_pool_wait(struct fox_pool *pool, struct fox_task *task);
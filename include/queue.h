@@ -0,0 +1,71 @@
+#pragma once
+
+#include <num.h>
+#include <fns.h>
+
+/*
+ * Bounded queues of chunksize items for passing records between threads,
+ * lock-free until a thread has to wait. Capacity is rounded up to a power
+ * of two. Items are copied in and out, so out must have room for count of
+ * them.
+ *
+ * fox_spsc may have one producer and one consumer thread at a time. Each
+ * side keeps its index on its own cache line with a copy of the other
+ * side's, which it only reloads when the copy says the queue is full, or
+ * empty.
+ *
+ * fox_mpmc takes any number of both. Every slot carries a sequence number
+ * that says whose turn it is, as in Dmitry Vyukov's bounded MPMC queue, and
+ * claiming slots is one compare and swap on the head or tail index.
+ *
+ * The try variants return at once with how much they did, the others spin
+ * for a while and then sleep until all count items went through. Waking a
+ * sleeper costs the other side a fence per call, the _n variants pay it
+ * once per batch.
+ *
+ *      struct fox_mpmc *q = fox_mpmc_new(sizeof(struct record), 1024);
+ *      fox_mpmc_push(q, &record);          producers
+ *      fox_mpmc_pop(q, &record);           consumers
+ */
+struct fox_spsc;
+struct fox_mpmc;
+
+/* NULL when there is no memory */
+struct fox_spsc *fox_spsc_new(const usize chunksize, const usize capacity);
+/* no thread may be using it, deletor runs on the items left */
+void            fox_spsc_del(struct fox_spsc *q, deletor *deletor);
+usize           fox_spsc_capacity(const struct fox_spsc *q);
+bool            fox_spsc_try_push(struct fox_spsc *q, const void *data);
+bool            fox_spsc_try_pop(struct fox_spsc *q, void *out);
+/* as many of count items as fit, in order, returns how many */
+usize           fox_spsc_try_push_n(struct fox_spsc *q, const void *data,
+                    const usize count);
+usize           fox_spsc_try_pop_n(struct fox_spsc *q, void *out,
+                    const usize count);
+void            fox_spsc_push(struct fox_spsc *q, const void *data);
+void            fox_spsc_pop(struct fox_spsc *q, void *out);
+void            fox_spsc_push_n(struct fox_spsc *q, const void *data,
+                    const usize count);
+void            fox_spsc_pop_n(struct fox_spsc *q, void *out,
+                    const usize count);
+
+struct fox_mpmc *fox_mpmc_new(const usize chunksize, const usize capacity);
+void            fox_mpmc_del(struct fox_mpmc *q, deletor *deletor);
+usize           fox_mpmc_capacity(const struct fox_mpmc *q);
+bool            fox_mpmc_try_push(struct fox_mpmc *q, const void *data);
+bool            fox_mpmc_try_pop(struct fox_mpmc *q, void *out);
+/*
+ * A batch takes consecutive slots, so the items of one try_push_n are not
+ * interleaved with those of other producers. push_n may take several
+ * batches when the queue has less room than count.
+ */
+usize           fox_mpmc_try_push_n(struct fox_mpmc *q, const void *data,
+                    const usize count);
+usize           fox_mpmc_try_pop_n(struct fox_mpmc *q, void *out,
+                    const usize count);
+void            fox_mpmc_push(struct fox_mpmc *q, const void *data);
+void            fox_mpmc_pop(struct fox_mpmc *q, void *out);
+void            fox_mpmc_push_n(struct fox_mpmc *q, const void *data,
+                    const usize count);
+void            fox_mpmc_pop_n(struct fox_mpmc *q, void *out,
+                    const usize count);
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdarg.h>
+
+#include <num.h>
+#include <alloc.h>
+
+/*
+ * Growable byte string, always followed by a NUL so fox_str_cstr can be
+ * handed to C functions. Up to FOX_STR_INLINE bytes are kept in the struct
+ * itself, longer strings live in a fox_alloc block whose capacity doubles
+ * as it fills. The string may contain NULs, its size says where it ends.
+ *
+ *      struct fox_str s = fox_str_from("id=");
+ *      fox_str_appendf(&s, "%d", id);
+ *      puts(fox_str_cstr(&s));
+ *      fox_str_del(&s);
+ */
+#define FOX_STR_INLINE  (3 * sizeof(usize) - 2)
+
+struct fox_str {
+    /* private, the last byte tells which one is in use */
+    union {
+        struct {
+            char *data;
+            usize size;
+            u8 pad[sizeof(usize) - 1];
+            u8 tag;
+        } heap;
+        struct {
+            char data[FOX_STR_INLINE + 1];
+            u8 tag;     /* the size */
+        } small;
+    } u;
+};
+
+/*
+ * A slice of a string owned by someone else, not NUL terminated. Views of
+ * a fox_str stay valid until it changes.
+ */
+struct fox_str_view {
+    const char *data;
+    usize size;
+};
+
+struct fox_str  fox_str_new(void);
+struct fox_str  fox_str_from(const char *cstr);
+struct fox_str  fox_str_from_n(const void *data, const usize size);
+struct fox_str  fox_str_from_view(const struct fox_str_view view);
+void            fox_str_del(struct fox_str *s);
+usize           fox_str_size(const struct fox_str *s);
+usize           fox_str_capacity(const struct fox_str *s);
+const char*     fox_str_cstr(const struct fox_str *s);
+/* the bytes, to change them in place */
+char*           fox_str_data(struct fox_str *s);
+/* false when there is no memory for capacity bytes */
+bool            fox_str_reserve(struct fox_str *s, const usize capacity);
+void            fox_str_clear(struct fox_str *s);
+/* keeps the first size bytes, nothing happens when it is not shorter */
+void            fox_str_truncate(struct fox_str *s, const usize size);
+/*
+ * The appends leave the string as it was when there is no memory. data may
+ * point into the string itself.
+ */
+void            fox_str_push(struct fox_str *s, const char c);
+void            fox_str_append(struct fox_str *s, const char *cstr);
+void            fox_str_append_n(struct fox_str *s, const void *data,
+                    const usize size);
+void            fox_str_append_view(struct fox_str *s,
+                    const struct fox_str_view view);
+void            fox_str_appendf(struct fox_str *s, const char *fmt, ...)
+                    __attribute__((format(printf, 2, 3)));
+void            fox_str_vappendf(struct fox_str *s, const char *fmt,
+                    va_list args);
+struct fox_str_view fox_str_as_view(const struct fox_str *s);
+/* from start up to, not including, end, both clamped to the size */
+struct fox_str_view fox_str_slice(const struct fox_str *s, usize start,
+                    usize end);
+isize           fox_str_find(const struct fox_str *s,
+                    const struct fox_str_view needle);
+
+struct fox_str_view fox_str_view_of(const char *cstr);
+struct fox_str_view fox_str_view_slice(const struct fox_str_view view,
+                    usize start, usize end);
+bool            fox_str_view_equal(const struct fox_str_view a,
+                    const struct fox_str_view b);
+/* index of the first match, 0 for an empty needle and -1 for none */
+isize           fox_str_view_find(const struct fox_str_view haystack,
+                    const struct fox_str_view needle);
+isize           fox_str_view_find_char(const struct fox_str_view haystack,
+                    const char c);
+/*
+ * Takes the text up to the next sep off the front of rest into piece and
+ * returns true, false once rest is used up. "a,,b" split on "," gives
+ * "a", "" and "b", an empty rest gives a single empty piece.
+ *
+ *      struct fox_str_view rest = fox_str_as_view(&line), field;
+ *      while (fox_str_view_split(&rest, fox_str_view_of(","), &field))
+ *          ...
+ */
+bool            fox_str_view_split(struct fox_str_view *rest,
+                    const struct fox_str_view sep,
+                    struct fox_str_view *piece);
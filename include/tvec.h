@@ -0,0 +1,171 @@
+#pragma once
+
+#include <assert.h>
+#include <string.h>
+
+#include <num.h>
+#include <alloc.h>
+#include <vec.h>
+
+/*
+ * FOX_VEC_DEFINE(name, T) generates struct name, a vector of T whose
+ * operations are static inline and move elements by assignment. The first
+ * three members match struct fox_vec, so name##_as_vec gives a pointer the
+ * vec.h functions accept. Those may reallocate items behind the cached
+ * capacity, call name##_sync afterwards.
+ *
+ *      FOX_VEC_DEFINE(ints, int)
+ *
+ *      struct ints v = ints_new();
+ *      ints_push(&v, 4);
+ *      int x = ints_at(&v, 0);
+ *      ints_del(&v, NULL);
+ */
+#define FOX_VEC_DEFINE(name, T)                                                \
+struct name {                                                                  \
+    const usize chunksize;                                                     \
+    usize size;                                                                \
+    T *items;                                                                  \
+    usize capacity;                                                            \
+};                                                                             \
+                                                                               \
+static inline struct name name##_new(void)                                     \
+{                                                                              \
+    struct name vec = { .chunksize = sizeof(T), 0 };                           \
+    vec.items = fox_reallocarray(NULL, 16, sizeof(T));                         \
+    vec.capacity = vec.items ? 16 : 0;                                         \
+    return vec;                                                                \
+}                                                                              \
+                                                                               \
+static inline struct name name##_from_vec(struct fox_vec vec)                  \
+{                                                                              \
+    assert(vec.chunksize == sizeof(T));                                        \
+    struct name typed = { .chunksize = sizeof(T), vec.size, vec.items,         \
+        fox_allocated(vec.items) / sizeof(T) };                                \
+    return typed;                                                              \
+}                                                                              \
+                                                                               \
+static inline struct fox_vec *name##_as_vec(struct name *vec)                  \
+{                                                                              \
+    return (struct fox_vec*) vec;                                              \
+}                                                                              \
+                                                                               \
+static inline void name##_sync(struct name *vec)                               \
+{                                                                              \
+    vec->capacity = fox_allocated(vec->items) / sizeof(T);                     \
+}                                                                              \
+                                                                               \
+static inline void name##_del(struct name *vec, deletor *deletor)              \
+{                                                                              \
+    assert(vec != NULL);                                                       \
+    if (deletor != NULL)                                                       \
+        for (usize i = 0; i < vec->size; i++)                                  \
+            deletor(vec->items + i);                                           \
+    fox_free(vec->items);                                                      \
+}                                                                              \
+                                                                               \
+static inline void name##_reserve(struct name *vec, const usize capacity)      \
+{                                                                              \
+    assert(vec != NULL);                                                       \
+    if (vec->capacity >= capacity)                                             \
+        return;                                                                \
+    T *items = fox_reallocarray(vec->items, capacity, sizeof(T));              \
+    if (items == NULL)                                                         \
+        return;                                                                \
+    vec->items = items;                                                        \
+    vec->capacity = capacity;                                                  \
+}                                                                              \
+                                                                               \
+static inline void name##_push(struct name *vec, T value)                      \
+{                                                                              \
+    assert(vec != NULL);                                                       \
+    if (vec->size == vec->capacity)                                            \
+        name##_reserve(vec, vec->capacity ? vec->capacity * 2 : 16);           \
+    if (vec->size == vec->capacity)                                            \
+        return;                                                                \
+    vec->items[vec->size++] = value;                                           \
+}                                                                              \
+                                                                               \
+static inline void name##_insert(struct name *vec, const usize index,          \
+    T value)                                                                   \
+{                                                                              \
+    assert(vec != NULL);                                                       \
+    if (index >= vec->size) {                                                  \
+        name##_push(vec, value);                                               \
+        return;                                                                \
+    }                                                                          \
+    if (vec->size == vec->capacity)                                            \
+        name##_reserve(vec, vec->capacity ? vec->capacity * 2 : 16);           \
+    if (vec->size == vec->capacity)                                            \
+        return;                                                                \
+    memmove(vec->items + index + 1, vec->items + index,                        \
+        (vec->size - index) * sizeof(T));                                      \
+    vec->items[index] = value;                                                 \
+    vec->size++;                                                               \
+}                                                                              \
+                                                                               \
+static inline T name##_at(const struct name *vec, const usize index)           \
+{                                                                              \
+    assert(vec != NULL && index < vec->size);                                  \
+    return vec->items[index];                                                  \
+}                                                                              \
+                                                                               \
+static inline T *name##_get(const struct name *vec, const usize index)         \
+{                                                                              \
+    assert(vec != NULL);                                                       \
+    return index < vec->size ? vec->items + index : NULL;                      \
+}                                                                              \
+                                                                               \
+static inline void name##_set(struct name *vec, const usize index, T value)    \
+{                                                                              \
+    assert(vec != NULL && index < vec->size);                                  \
+    vec->items[index] = value;                                                 \
+}                                                                              \
+                                                                               \
+static inline T *name##_front(const struct name *vec)                          \
+{                                                                              \
+    return name##_get(vec, 0);                                                 \
+}                                                                              \
+                                                                               \
+static inline T *name##_back(const struct name *vec)                           \
+{                                                                              \
+    assert(vec != NULL);                                                       \
+    return vec->size ? vec->items + vec->size - 1 : NULL;                      \
+}                                                                              \
+                                                                               \
+static inline T name##_pop(struct name *vec)                                   \
+{                                                                              \
+    assert(vec != NULL && vec->size > 0);                                      \
+    return vec->items[--vec->size];                                            \
+}                                                                              \
+                                                                               \
+static inline void name##_remove(struct name *vec, const usize index,          \
+    deletor *deletor)                                                          \
+{                                                                              \
+    assert(vec != NULL);                                                       \
+    if (index >= vec->size)                                                    \
+        return;                                                                \
+    if (deletor != NULL)                                                       \
+        deletor(vec->items + index);                                           \
+    memmove(vec->items + index, vec->items + index + 1,                        \
+        (vec->size - index - 1) * sizeof(T));                                  \
+    vec->size--;                                                               \
+}                                                                              \
+                                                                               \
+static inline void name##_clear(struct name *vec)                              \
+{                                                                              \
+    vec->size = 0;                                                             \
+}                                                                              \
+                                                                               \
+/* compares with memcmp when equals is NULL, like fox_vec_find */             \
+static inline isize name##_find(const struct name *vec, const T needle,        \
+    bool (*equals)(const T *a, const T *b))                                    \
+{                                                                              \
+    assert(vec != NULL);                                                       \
+    for (usize i = 0; i < vec->size; i++) {                                    \
+        if (equals != NULL ? equals(vec->items + i, &needle) :                 \
+            memcmp(vec->items + i, &needle, sizeof(T)) == 0)                   \
+            return i;                                                          \
+    }                                                                          \
+    return -1;                                                                 \
+}
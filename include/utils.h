@@ -2,4 +2,36 @@
 
 #include <num.h>
 
+/*
+ * Memory kernels running 8, 16 or 32 bytes at a time with plain words, SSE2
+ * or AVX2, whichever the CPU has, chosen once on first use.
+ *
+ * fox_memcopy needs distinct ranges, fox_memmove handles overlap in either
+ * direction and fox_rmemcpy copies backwards, for dest above src. fox_memfill
+ * writes count copies of a size-byte pattern. fox_memcompare orders like
+ * memcmp.
+ */
 void*   fox_rmemcpy(void *dest, const void *src, usize n);
+void*   fox_memcopy(void *dest, const void *src, usize n);
+void*   fox_memmove(void *dest, const void *src, usize n);
+void*   fox_memfill(void *dest, usize count, const void *pattern, usize size);
+int     fox_memcompare(const void *a, const void *b, usize n);
+
+/*
+ * Search count items of size bytes for those equal to needle, byte for byte.
+ * Items of 1, 2, 4 or 8 bytes are compared a register at a time. The finds
+ * return -1 when there is no match.
+ */
+isize   fox_memfind(const void *items, usize count, usize size,
+            const void *needle);
+isize   fox_memfind_last(const void *items, usize count, usize size,
+            const void *needle);
+usize   fox_memcount(const void *items, usize count, usize size,
+            const void *needle);
+
+/*
+ * Index of the first occurrence of the m bytes of needle in the n bytes of
+ * haystack, 0 for an empty needle and -1 when there is none.
+ */
+isize   fox_memsearch(const void *haystack, usize n, const void *needle,
+            usize m);
@@ -2,6 +2,9 @@
 
 #include <num.h>
 #include <fns.h>
+#include <alloc.h>
+
+struct fox_arena;
 
 struct fox_vec {
     const usize chunksize;
@@ -9,24 +12,135 @@ struct fox_vec {
     void *items;
 };
 
+/*
+ * A vector whose first n items live in a compound literal of the enclosing
+ * block, it only allocates once it grows past them. It must not be used
+ * after that block ends, fox_vec_del is still needed in case it spilled.
+ *
+ *      struct fox_vec vec = FOX_VEC_INLINE(int, 4);
+ */
+#define FOX_VEC_INLINE(type, n) fox_vec_new_inline(sizeof(type),            \
+    (u8[FOX_INLINE_SIZE(sizeof(type) * (n))]) {0},                          \
+    FOX_INLINE_SIZE(sizeof(type) * (n)))
+
 struct fox_vec  fox_vec_new(const usize chunksize);
+struct fox_vec  fox_vec_new_aligned(const usize chunksize,
+                    const usize alignment);
+struct fox_vec  fox_vec_new_in(struct fox_arena *arena,
+                    const usize chunksize);
+/* buf as in fox_alloc_inline, with size bytes */
+struct fox_vec  fox_vec_new_inline(const usize chunksize, void *buf,
+                    const usize size);
+
+enum fox_vec_map_flags {
+    FOX_VEC_MAP_CREATE = 1 << 0,    /* create the file when it is missing */
+    FOX_VEC_MAP_TRUNCATE = 1 << 1,  /* start empty even when it exists */
+};
+
+/*
+ * A vector whose items live in a shared mapping of the file at path, so
+ * they outlive the process and may be larger than memory. The file starts
+ * with a small header recording chunksize and size, opening it again maps
+ * the items as they are without reading them. Growing extends the file and
+ * remaps it, which may move items. Every other fox_vec function works on it.
+ *
+ * size is written to the header by fox_vec_map_sync and fox_vec_del, a
+ * process dying in between leaves the size of the last sync. items is NULL
+ * and errno set when the file cannot be mapped or holds a different
+ * chunksize.
+ *
+ *      struct fox_vec log = fox_vec_map("log.vec", sizeof(struct entry),
+ *          FOX_VEC_MAP_CREATE);
+ *      fox_vec_push(&log, &entry);
+ *      fox_vec_map_sync(&log, true);
+ */
+struct fox_vec  fox_vec_map(const char *path, const usize chunksize,
+                    const int flags);
+bool            fox_vec_is_mapped(const struct fox_vec *vec);
+/* records size and flushes the items, waiting for the disk when wait */
+bool            fox_vec_map_sync(struct fox_vec *vec, const bool wait);
+/*
+ * madvise advice on the pages of items start up to, not including, end. The
+ * first page also holds the file header and is left out, items sharing a
+ * page with the range are advised with it.
+ */
+bool            fox_vec_map_advise(const struct fox_vec *vec,
+                    const usize start, usize end, const int advice);
 void            fox_vec_del(struct fox_vec *vec, deletor *deletor);
 void            fox_vec_push(struct fox_vec *vec, void *data);
+/* data holds count items and must not point into vec */
+void            fox_vec_push_n(struct fox_vec *vec, const void *data,
+                    const usize count);
+void            fox_vec_extend(struct fox_vec *vec,
+                    const struct fox_vec *other);
+/* room for count more items at the end, for the caller to fill */
+void*           fox_vec_append_uninit(struct fox_vec *vec, const usize count);
 void            fox_vec_insert(struct fox_vec *vec, const usize index,
                     void *data);
+void            fox_vec_insert_n(struct fox_vec *vec, const usize index,
+                    const void *data, const usize count);
 void            fox_vec_fill(struct fox_vec *vec, void *data);
+/*
+ * Positive rotations move items towards the end, negative ones towards the
+ * front, modulo the number of items. Done in place without allocating.
+ */
 void            fox_vec_rotate(struct fox_vec *vec, const isize rotation);
+void            fox_vec_rotate_range(struct fox_vec *vec, const usize start,
+                    usize end, const isize rotation);
 void*           fox_vec_front(const struct fox_vec *vec);
 void*           fox_vec_back(const struct fox_vec *vec);
 void*           fox_vec_get(const struct fox_vec *vec, const usize index);
 void            fox_vec_pop(struct fox_vec *vec, deletor *deletor);
 void            fox_vec_remove(struct fox_vec *vec, const usize index,
                     deletor *deletor);
+/* removes the items from start up to, not including, end */
+void            fox_vec_remove_range(struct fox_vec *vec, const usize start,
+                    usize end, deletor *deletor);
+/* moves the last item into index instead of shifting the tail */
+void            fox_vec_swap_remove(struct fox_vec *vec, const usize index,
+                    deletor *deletor);
+/* keeps the items keep is true for, in order */
+void            fox_vec_retain(struct fox_vec *vec, predicate *keep,
+                    deletor *deletor);
+/*
+ * Removes the items equal to the one before them, so every duplicate of a
+ * sorted vector. comparar tells whether two items are equal, memcmp is used
+ * when it is NULL.
+ */
+void            fox_vec_dedup(struct fox_vec *vec, comparar *comparar,
+                    deletor *deletor);
 void            fox_vec_reserve(struct fox_vec *vec, const usize capacity);
 void            fox_vec_shrink_to_fit(struct fox_vec *vec);
 bool            fox_vec_is_empty(const struct fox_vec *vec);
 bool            fox_vec_is_sorted(const struct fox_vec *vec,
                     comparar *comparar);
+/*
+ * comparar tells whether a may come before b, as for fox_vec_is_sorted, and
+ * items are compared with memcmp when it is NULL. fox_vec_sort does not keep
+ * equal items in order, fox_vec_stable_sort does and needs room for a copy
+ * of the items. fox_vec_sort_by_key is a stable radix sort on the unsigned
+ * key of each item, flip the sign bit of signed keys.
+ */
+void            fox_vec_sort(struct fox_vec *vec, comparar *comparar);
+void            fox_vec_stable_sort(struct fox_vec *vec, comparar *comparar);
+void            fox_vec_sort_by_key(struct fox_vec *vec, keyof *keyof);
+/*
+ * Without a comparar items are compared byte for byte, with SIMD for items
+ * of 1, 2, 4 or 8 bytes. comparar(item, needle) tells whether they match.
+ */
 isize           fox_vec_find(const struct fox_vec *vec, const void *needle,
                     comparar *comparar);
+isize           fox_vec_find_last(const struct fox_vec *vec,
+                    const void *needle, comparar *comparar);
+usize           fox_vec_count(const struct fox_vec *vec, const void *needle,
+                    comparar *comparar);
+/*
+ * For vectors sorted by comparar as in fox_vec_sort. lower_bound is the index
+ * of the first item not before needle, bsearch that of an item equal to it
+ * or -1.
+ */
+usize           fox_vec_lower_bound(const struct fox_vec *vec,
+                    const void *needle, comparar *comparar);
+isize           fox_vec_bsearch(const struct fox_vec *vec, const void *needle,
+                    comparar *comparar);
 void            fox_vec_swap(struct fox_vec *vec, struct fox_vec *vec2);
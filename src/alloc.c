@@ -3,12 +3,22 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define STACK_SIZE 128
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "alloc_private.h"
+
+#define CANARY_SIZE 100
+#define SAMPLE_INTERVAL (512 * 1024)
+#define MMAP_THRESHOLD  (1024 * 1024)
 #define MUL_NO_OVERFLOW ((size_t) 1 << (sizeof(size_t) * 4))
 
 enum FLAGS {
@@ -18,48 +28,77 @@ enum FLAGS {
     XMALLOC = 1 << 3,
     LOUD = 1 << 4,
     DUMPC = 1 << 5,
+    SLAB = 1 << 6,
+    DUMP = 1 << 7,
+    PROFILE = 1 << 8,
+    LAZYCHECK = 1 << 9,
+    MMAP = 1 << 10,
+    HUGEPAGE = 1 << 11,
+    TRACK = FCHECK | DUMP,
 };
 
-/* private hashmap start */
-enum _state {
-    EMPTY,
-    VALID,
-    DELETED
-};
+/* private tracking table start */
+#define TRACK_SHARDS    64
 
 struct _allocation_info {
-    /* void *trace[STACK_SIZE]; */
     bool freed;
 };
 
-struct _hashmap_pair {
-    enum _state state;
-    void *key;
-    struct _allocation_info value;
-};
-
-struct _hashmap {
-    usize len;
-    usize cap;
-    struct _hashmap_pair *pairs;
+/*
+ * A fox_map from block to _allocation_info per shard. Its table comes from
+ * malloc, the allocator cannot track its own tracking. Removal leaves no
+ * tombstones, fox_map moves a later entry into the hole instead.
+ *
+ * Outside of fox_check_all and dumps a shard is only held for one map
+ * operation, so it is locked with a flag rather than a mutex, and waiters
+ * yield until it is free.
+ */
+struct _track_shard {
+    bool locked;
+    struct fox_map map;
+} __attribute__((aligned(64)));
+
+static u64      _mix(const void *key);
+static u64      _track_hash(const void *key);
+static void     _shard_lock(struct _track_shard *shard);
+static void     _shard_unlock(struct _track_shard *shard);
+static void     track_insert(void *key, const struct _allocation_info *info);
+static bool     track_release(void *key, bool strict);
+static bool     track_remove(void *key, struct _allocation_info *info);
+/* private tracking table end */
+
+#define CHECK_WORKERS 16
+
+struct _check_batch {
+    usize first;
+    usize step;
+    bool ok;
 };
 
-static u32      _djb2(const void *bytes, usize len);
-static usize    hashmap_insert(struct _hashmap *hm, void *key,
-                    struct _allocation_info *info);
-static void     hashmap_remove(struct _hashmap *hm, usize it);
-static usize    hashmap_find(const struct _hashmap *hm, void *key);
-static bool     hashmap_resize(struct _hashmap *hm);
-/* private hashmap end */
-
 const char *fox_alloc_options = NULL;
 
-static u8 alloc_flags = 0 | LOUD; /* make it "loud" */
-static struct _hashmap table = {0};
+static u32 alloc_flags = 0 | LOUD; /* make it "loud" */
+static usize canary_size = 0;
+static usize mmap_threshold = MMAP_THRESHOLD;
+static struct _track_shard table[TRACK_SHARDS];
 
-static bool initialized = false;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
 static void _fox_alloc_init();
 static void _fox_alloc_dump();
+static usize _parse_num(const char **opts, usize fallback);
+static bool _canary_ok(const u8 *canary, usize n);
+static void _check_block(struct foxptr *ptr, void *data);
+static void *_check_shards(void *data);
+
+static void            *_fox_realloc(void *ptr, usize new_size, usize shift,
+                            bool zero);
+static i32              _align_shift(usize alignment);
+static struct foxptr   *_block_alloc(usize size, bool zero, usize shift);
+static struct foxptr   *_block_realloc(struct foxptr *p, usize new_size,
+                            usize shift);
+static void             _block_free(struct foxptr *p);
+static void            *_inline_realloc(struct foxptr *p, usize new_size,
+                            usize shift, bool zero);
 
 
 static void *(*_malloc)(usize) = malloc;
@@ -69,10 +108,9 @@ static void  (*_free)(void *) = free;
 
 void *fox_alloc(usize size)
 {
-    if (!initialized) _fox_alloc_init();
+    pthread_once(&init_once, _fox_alloc_init);
 
-    struct foxptr *ptr = _malloc(sizeof(*ptr) + size +
-        ((alloc_flags & CANARY) ? 100 : 0));
+    struct foxptr *ptr = _block_alloc(size, false, 0);
 
     if (ptr == NULL) {
         if (alloc_flags & XMALLOC) {
@@ -83,23 +121,7 @@ void *fox_alloc(usize size)
         return NULL;
     }
 
-    if (alloc_flags & CANARY)
-        memset(ptr->data + size, 0, 100);
-
-    if (alloc_flags & LOUD)
-        memset(ptr->data, 0xAA, size);
-
-    if (alloc_flags & DUMPC || alloc_flags & FCHECK) {
-        struct _allocation_info info = {0};
-        info.freed = false;
-        hashmap_insert(&table, ptr, &info);
-    }
-
-    ptr->allocated = size;
-
-    if (alloc_flags & VERBOSE)
-        fprintf(stderr, "Allocated %ld bytes for pointer %p\n", size, ptr->data
-            );
+    _fox_block_init(ptr, false);
 
     return ptr->data;
 }
@@ -109,41 +131,8 @@ void *fox_realloc(void *ptr, usize new_size)
     if (ptr == NULL)
         return fox_alloc(new_size);
 
-    struct foxptr *p = fox_visualize(ptr);
-    usize current_size = p->allocated;
-    struct foxptr *next = _realloc(p, sizeof(*p) + new_size +
-        ((alloc_flags & CANARY) ? 100 : 0));
-
-    if (next == NULL) {
-        if (alloc_flags & XMALLOC) {
-            fprintf(stderr, "Failed to realloc pointer at %p of size %ld to"
-                " %ld bytes on the heap!\n", ptr, p->allocated, new_size);
-            abort();
-        }
-
-        return NULL;
-    }
-
-    if (alloc_flags & CANARY)
-        memset(next->data + new_size, 0, 100);
-
-    if (alloc_flags & LOUD)
-        memset(next->data + current_size, 0xAA, new_size - current_size);
-
-    if (alloc_flags & DUMPC || alloc_flags & FCHECK)
-        if (p != next) {
-            struct _allocation_info info = table.pairs[hashmap_find(&table, p)].value;
-            hashmap_remove(&table, hashmap_find(&table, p));
-            hashmap_insert(&table, ptr, &info);
-        }
-
-    next->allocated = new_size;
-
-    if (alloc_flags & VERBOSE)
-        fprintf(stderr, "Reallocated pointer %p from %ld bytes to %ld bytes "
-            "at pointer %p\n", p->data, current_size, new_size, next->data);
-
-    return next->data;
+    return _fox_realloc(ptr, new_size,
+        fox_tag_align(fox_tag(fox_visualize(ptr))), false);
 }
 
 void *fox_recalloc(void *ptr, usize new_size)
@@ -151,41 +140,64 @@ void *fox_recalloc(void *ptr, usize new_size)
     if (ptr == NULL)
         return fox_alloczero(new_size);
 
-    struct foxptr *p = fox_visualize(ptr);
-    usize current_size = p->allocated;
-    struct foxptr *next = _realloc(p, sizeof(*p) + new_size +
-        ((alloc_flags & CANARY) ? 100 : 0));
+    return _fox_realloc(ptr, new_size,
+        fox_tag_align(fox_tag(fox_visualize(ptr))), true);
+}
 
-    if (next == NULL) {
+void *fox_alloc_aligned(usize size, usize alignment)
+{
+    pthread_once(&init_once, _fox_alloc_init);
+
+    i32 shift = _align_shift(alignment);
+    if (shift < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct foxptr *ptr = _block_alloc(size, false, shift);
+
+    if (ptr == NULL) {
         if (alloc_flags & XMALLOC) {
-            fprintf(stderr, "Failed to realloc pointer at %p of size %ld to"
-                " %ld bytes on the heap!\n", ptr, p->allocated, new_size);
+            fprintf(stderr, "Failed to allocate %lu bytes aligned to %lu on "
+                "the heap!\n", size, alignment);
             abort();
         }
 
         return NULL;
     }
 
-    memset(next->data + current_size, 0, new_size - current_size);
+    _fox_block_init(ptr, false);
+
+    return ptr->data;
+}
 
-    if (alloc_flags & CANARY) {
-        memset(next->data + new_size, 0, 100);
+void *fox_realloc_aligned(void *ptr, usize new_size, usize alignment)
+{
+    i32 shift = _align_shift(alignment);
+    if (shift < 0) {
+        errno = EINVAL;
+        return NULL;
     }
 
-    if (alloc_flags & DUMPC || alloc_flags & FCHECK)
-        if (p != next) {
-            struct _allocation_info info = table.pairs[hashmap_find(&table, p)].value;
-            hashmap_remove(&table, hashmap_find(&table, p));
-            hashmap_insert(&table, ptr, &info);
-        }
+    if (ptr == NULL)
+        return fox_alloc_aligned(new_size, alignment);
 
-    next->allocated = new_size;
+    return _fox_realloc(ptr, new_size, shift, false);
+}
 
-    if (alloc_flags & VERBOSE)
-        fprintf(stderr, "Reallocated pointer %p from %ld bytes to %ld bytes "
-            "at pointer %p\n", p->data, current_size, new_size, next->data);
+void *fox_alloc_inline(void *buf, usize size)
+{
+    u8 *data = (u8*) (((uintptr_t) buf + FOX_HDR_SIZE + FOX_ALIGN - 1) &
+        ~(uintptr_t) (FOX_ALIGN - 1));
 
-    return next->data;
+    if (buf == NULL || data > (u8*) buf + size)
+        return NULL;
+
+    struct foxptr *ptr = fox_visualize(data);
+    fox_tag(ptr) = fox_tag_make(FOX_INLINE, (u8*) buf + size - data);
+    ptr->allocated = (u8*) buf + size - data;
+
+    return data;
 }
 
 void fox_free(void *ptr)
@@ -195,24 +207,18 @@ void fox_free(void *ptr)
 
     struct foxptr *p = fox_visualize(ptr);
 
-    if (alloc_flags & DUMPC || alloc_flags & FCHECK) {
-        struct _allocation_info info = table.pairs[hashmap_find(&table, p)].value;
-        if (info.freed && alloc_flags & FCHECK) {
-            fprintf(stderr, "*** double free detected ***: terminated\n");
-            abort();
-        }
+    if (fox_tag_kind(fox_tag(p)) == FOX_INLINE)
+        return;
 
-        table.pairs[hashmap_find(&table, p)].value.freed = true;
+    if (fox_tag_kind(fox_tag(p)) == FOX_FILE) {
+        _fox_file_free(p);
+        return;
     }
 
-    if (alloc_flags & CANARY) {
-        if (!fox_check(ptr)) {
-            fprintf(stderr, "*** heap smashing detected ***: terminated\n");
-            abort();
-        }
-    }
+    _fox_block_release(p, true);
+    _fox_stats_free(1, p->allocated);
 
-    _free(fox_visualize(ptr));
+    _block_free(p);
 
     if (alloc_flags & VERBOSE)
         fprintf(stderr, "Freed a pointer at address %p\n", ptr);
@@ -242,10 +248,9 @@ void *fox_recallocarray(void *ptr, usize new_nmemb, usize size)
 
 void *fox_alloczero(usize size)
 {
-    if (!initialized) _fox_alloc_init();
+    pthread_once(&init_once, _fox_alloc_init);
 
-    struct foxptr *ptr = _calloc(sizeof(*ptr) + size +
-        ((alloc_flags & CANARY) ? 100 : 0), 1);
+    struct foxptr *ptr = _block_alloc(size, true, 0);
 
     if (ptr == NULL) {
         if (alloc_flags & XMALLOC) {
@@ -257,17 +262,7 @@ void *fox_alloczero(usize size)
         return NULL;
     }
 
-    if (alloc_flags & DUMPC || alloc_flags & FCHECK) {
-        struct _allocation_info info = {0};
-        info.freed = false;
-        hashmap_insert(&table, ptr, &info);
-    }
-
-    ptr->allocated = size;
-
-    if (alloc_flags & VERBOSE)
-        fprintf(stderr, "Allocated %ld bytes for pointer %p\n", size, ptr->data
-            );
+    _fox_block_init(ptr, true);
 
     return ptr->data;
 }
@@ -279,44 +274,80 @@ void fox_freezero(void *ptr)
 
     struct foxptr *p = fox_visualize(ptr);
 
-    if (alloc_flags & DUMPC || alloc_flags & FCHECK) {
-        struct _allocation_info info = table.pairs[hashmap_find(&table, p)].value;
-        if (info.freed && alloc_flags & FCHECK) {
-            fprintf(stderr, "*** double free detected ***: terminated\n");
-            abort();
-        }
-
-        table.pairs[hashmap_find(&table, p)].value.freed = true;
+    if (fox_tag_kind(fox_tag(p)) == FOX_INLINE) {
+        memset(p->data, 0, p->allocated);
+        return;
     }
 
-    if (alloc_flags & CANARY) {
-        if (!fox_check(ptr)) {
-            fprintf(stderr, "*** heap smashing detected ***: terminated\n");
-            abort();
-        }
+    if (fox_tag_kind(fox_tag(p)) == FOX_FILE) {
+        memset(p->data, 0, p->allocated);
+        _fox_file_free(p);
+        return;
     }
 
-    memset(p, 0, sizeof(*p) + p->allocated);
+    _fox_block_release(p, true);
+    _fox_stats_free(1, p->allocated);
 
-    _free(p);
+    /* the header stays, freeing a mapping needs its size */
+    memset(p->data, 0, p->allocated);
+
+    _block_free(p);
     if (alloc_flags & VERBOSE)
         fprintf(stderr, "Freed a pointer at address %p\n", ptr);
 }
 
 bool fox_check(void *ptr)
 {
-    if (ptr == NULL)
+    if (ptr == NULL || !(alloc_flags & CANARY))
         return true;
 
     struct foxptr *p = fox_visualize(ptr);
-    u8 *iter = p->data + p->allocated;
-    i32 i = 0;
+    usize kind = fox_tag_kind(fox_tag(p));
+
+    if (kind == FOX_INLINE || kind == FOX_FILE)
+        return true;
+
+    return _canary_ok(p->data + p->allocated, canary_size);
+}
+
+bool fox_check_all()
+{
+    pthread_once(&init_once, _fox_alloc_init);
+
+    if (!(alloc_flags & CANARY) || !(alloc_flags & TRACK))
+        return true;
 
-    for (; i < 100; i++, iter++) {
-        if (*iter) return false;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    usize workers = cpus < 1 ? 1 : cpus > CHECK_WORKERS ? CHECK_WORKERS : cpus;
+    pthread_t threads[CHECK_WORKERS];
+    bool spawned[CHECK_WORKERS] = {0};
+    struct _check_batch batches[CHECK_WORKERS];
+    bool ok = true;
+
+    /* worker i sweeps every workers-th shard, the caller is worker 0 */
+    for (usize i = 0; i < workers; i++) {
+        batches[i].first = i;
+        batches[i].step = workers;
+        batches[i].ok = true;
+
+        if (i > 0)
+            spawned[i] = pthread_create(threads + i, NULL, _check_shards,
+                batches + i) == 0;
     }
 
-    return true;
+    _check_shards(batches);
+
+    for (usize i = 1; i < workers; i++) {
+        if (spawned[i])
+            pthread_join(threads[i], NULL);
+        else
+            _check_shards(batches + i);
+    }
+
+    for (usize i = 0; i < workers; i++)
+        ok &= batches[i].ok;
+
+    return ok;
 }
 
 usize fox_allocated(void *ptr)
@@ -349,9 +380,322 @@ void fox_set_free(void (*fn)(void *))
     _free = fn;
 }
 
+void *_fox_raw_alloc(usize size)
+{
+    return _malloc(size);
+}
+
+void _fox_raw_free(void *ptr)
+{
+    _free(ptr);
+}
+
+void _fox_alloc_setup()
+{
+    pthread_once(&init_once, _fox_alloc_init);
+}
+
+bool _fox_alloc_tracked()
+{
+    return alloc_flags & TRACK;
+}
+
+bool _fox_alloc_profiled()
+{
+    return alloc_flags & PROFILE;
+}
+
+usize _fox_canary_size()
+{
+    return canary_size;
+}
+
+void _fox_block_init(struct foxptr *ptr, bool zero)
+{
+    if (alloc_flags & CANARY)
+        memset(ptr->data + ptr->allocated, 0, canary_size);
+
+    if (alloc_flags & LOUD && !zero)
+        memset(ptr->data, 0xAA, ptr->allocated);
+
+    if (alloc_flags & TRACK) {
+        struct _allocation_info info = {0};
+        info.freed = false;
+        track_insert(ptr, &info);
+    }
+
+    if (alloc_flags & PROFILE)
+        _fox_profile_alloc(ptr);
+
+    _fox_stats_alloc(ptr->allocated);
+
+    if (alloc_flags & VERBOSE)
+        fprintf(stderr, "Allocated %ld bytes for pointer %p\n", ptr->allocated,
+            ptr->data);
+}
+
+void _fox_block_release(struct foxptr *p, bool strict)
+{
+    if (alloc_flags & TRACK &&
+        !track_release(p, strict && alloc_flags & FCHECK)) {
+        fprintf(stderr, "*** double free detected ***: terminated\n");
+        abort();
+    }
+
+    if (fox_tag(p) & FOX_TAG_SAMPLED)
+        _fox_profile_free(p);
+
+    if (alloc_flags & CANARY && !(alloc_flags & LAZYCHECK)) {
+        if (!fox_check(p->data)) {
+            fprintf(stderr, "*** heap smashing detected ***: terminated\n");
+            abort();
+        }
+    }
+}
+
+static void *_fox_realloc(void *ptr, usize new_size, usize shift, bool zero)
+{
+    struct foxptr *p = fox_visualize(ptr);
+    usize current_size = p->allocated;
+
+    if (fox_tag_kind(fox_tag(p)) == FOX_INLINE)
+        return _inline_realloc(p, new_size, shift, zero);
+
+    /* a grown file reads as zeros already */
+    if (fox_tag_kind(fox_tag(p)) == FOX_FILE) {
+        struct foxptr *next = _fox_file_realloc(p, new_size);
+
+        if (next == NULL && alloc_flags & XMALLOC) {
+            fprintf(stderr, "Failed to remap file pointer at %p of size %ld"
+                " to %ld bytes!\n", ptr, current_size, new_size);
+            abort();
+        }
+
+        return next != NULL ? next->data : NULL;
+    }
+
+    struct _allocation_info info = {0};
+    void *sample = NULL;
+
+    if (fox_tag(p) & FOX_TAG_SAMPLED)
+        sample = _fox_profile_detach(p);
+
+    /* untracked while it moves, so fox_check_all never reads a stale block */
+    bool tracked = alloc_flags & TRACK && track_remove(p, &info);
+
+    struct foxptr *next = _block_realloc(p, new_size, shift);
+
+    if (next == NULL) {
+        if (tracked)
+            track_insert(p, &info);
+        _fox_profile_reattach(p, sample);
+
+        if (alloc_flags & XMALLOC) {
+            fprintf(stderr, "Failed to realloc pointer at %p of size %ld to"
+                " %ld bytes on the heap!\n", ptr, current_size, new_size);
+            abort();
+        }
+
+        return NULL;
+    }
+
+    if (zero && new_size > current_size)
+        memset(next->data + current_size, 0, new_size - current_size);
+
+    if (alloc_flags & CANARY)
+        memset(next->data + new_size, 0, canary_size);
+
+    if (alloc_flags & LOUD && !zero && new_size > current_size)
+        memset(next->data + current_size, 0xAA, new_size - current_size);
+
+    if (alloc_flags & TRACK)
+        track_insert(next, &info);
+
+    _fox_stats_realloc(current_size, new_size, p != next);
+
+    if (sample != NULL)
+        _fox_profile_drop(sample);
+
+    if (alloc_flags & PROFILE)
+        _fox_profile_alloc(next);
+
+    if (alloc_flags & VERBOSE)
+        fprintf(stderr, "Reallocated pointer %p from %ld bytes to %ld bytes "
+            "at pointer %p\n", ptr, current_size, new_size, next->data);
+
+    return next->data;
+}
+
+/* stays in the caller's buffer while it fits, then becomes a regular block */
+static void *_inline_realloc(struct foxptr *p, usize new_size, usize shift,
+    bool zero)
+{
+    usize current_size = p->allocated;
+
+    if (!shift && new_size <= fox_tag_value(fox_tag(p))) {
+        if (zero && new_size > current_size)
+            memset(p->data + current_size, 0, new_size - current_size);
+
+        p->allocated = new_size;
+        return p->data;
+    }
+
+    u8 *data = shift ? fox_alloc_aligned(new_size, (usize) 1 << shift) :
+        zero ? fox_alloczero(new_size) : fox_alloc(new_size);
+
+    if (data != NULL)
+        memcpy(data, p->data, current_size < new_size ? current_size :
+            new_size);
+
+    return data;
+}
+
+/* log2 of a valid alignment, 0 for the default one, -1 when invalid */
+static i32 _align_shift(usize alignment)
+{
+    static usize page = 0;
+    i32 shift = 0;
+
+    if (page == 0)
+        page = sysconf(_SC_PAGESIZE);
+
+    if (alignment == 0 || alignment & (alignment - 1) || alignment > page)
+        return -1;
+
+    if (alignment <= FOX_ALIGN)
+        return 0;
+
+    while (((usize) 1 << shift) < alignment)
+        shift++;
+
+    return shift;
+}
+
+static struct foxptr *_block_alloc(usize size, bool zero, usize shift)
+{
+    usize pad = shift ? ((usize) 1 << shift) - FOX_ALIGN : 0;
+    usize total = FOX_HDR_SIZE + pad + size +
+        canary_size;
+    usize *base, tag;
+    i32 cls;
+
+    if (total < size)
+        return NULL;
+
+    if (alloc_flags & MMAP && total >= mmap_threshold)
+        return _fox_mmap_alloc(size, canary_size, shift,
+            alloc_flags & HUGEPAGE);
+
+    if (shift) {
+        u8 *raw = zero ? _calloc(total, 1) : _malloc(total);
+        if (raw == NULL)
+            return NULL;
+
+        /* data sits on the next multiple of the alignment past the header */
+        usize mask = ((usize) 1 << shift) - 1;
+        u8 *data = (u8*) (((uintptr_t) raw + FOX_HDR_SIZE + mask) & ~mask);
+        usize offset = data - FOX_HDR_SIZE - raw;
+
+        base = (void*) (raw + offset);
+        tag = fox_tag_make(FOX_HEAP, offset) | fox_tag_align_make(shift);
+    } else if (alloc_flags & SLAB && (cls = _fox_slab_class(total)) >= 0) {
+        base = _fox_slab_alloc(cls);
+        if (base != NULL && zero)
+            memset(base, 0, total);
+        tag = fox_tag_make(FOX_SLAB, cls);
+    } else {
+        base = zero ? _calloc(total, 1) : _malloc(total);
+        tag = fox_tag_make(FOX_HEAP, 0);
+    }
+
+    if (base == NULL)
+        return NULL;
+
+    struct foxptr *ptr = (void*) (base + 1);
+    fox_tag(ptr) = tag;
+    ptr->allocated = size;
+
+    return ptr;
+}
+
+static struct foxptr *_block_realloc(struct foxptr *p, usize new_size,
+    usize shift)
+{
+    usize total = FOX_HDR_SIZE + new_size +
+        canary_size;
+    usize tag = fox_tag(p);
+
+    if (total < new_size)
+        return NULL;
+
+    if (fox_tag_kind(tag) == FOX_ARENA && !shift)
+        return _fox_arena_realloc(p, new_size);
+
+    /* mapped blocks stay mapped when they shrink below the threshold */
+    if (fox_tag_kind(tag) == FOX_MMAP && shift == fox_tag_align(tag))
+        return _fox_mmap_realloc(p, new_size, canary_size);
+
+    if (fox_tag_kind(tag) == FOX_SLAB && !shift &&
+        total <= _fox_slab_size(fox_tag_value(tag))) {
+        p->allocated = new_size;
+        return p;
+    }
+
+    /*
+     * only plain heap blocks can be handed to realloc as they are, one
+     * growing past the mmap threshold is copied a last time into a mapping
+     */
+    if (fox_tag_kind(tag) != FOX_HEAP || shift || fox_tag_align(tag) ||
+        (alloc_flags & MMAP && total >= mmap_threshold)) {
+        struct foxptr *next = _block_alloc(new_size, false, shift);
+        if (next == NULL)
+            return NULL;
+
+        memcpy(next->data, p->data, p->allocated < new_size ?
+            p->allocated : new_size);
+        _block_free(p);
+
+        return next;
+    }
+
+    usize *base = _realloc(fox_base(p), total);
+    if (base == NULL)
+        return NULL;
+
+    struct foxptr *next = (void*) (base + 1);
+    next->allocated = new_size;
+
+    return next;
+}
+
+static void _block_free(struct foxptr *p)
+{
+    usize tag = fox_tag(p);
+
+    switch (fox_tag_kind(tag)) {
+    case FOX_SLAB:
+        _fox_slab_free(fox_base(p), fox_tag_value(tag));
+        break;
+    case FOX_ARENA:
+        _fox_arena_free(p);
+        break;
+    case FOX_MMAP:
+        _fox_mmap_free(p, canary_size);
+        break;
+    default:
+        _free((u8*) fox_base(p) - fox_tag_value(tag));
+    }
+}
+
 static void _fox_alloc_init()
 {
-    initialized = true;
+    for (usize i = 0; i < TRACK_SHARDS; i++) {
+        struct fox_map map = _fox_map_new_raw(sizeof(void*),
+            sizeof(struct _allocation_info), _track_hash, NULL);
+
+        memcpy(&table[i].map, &map, sizeof(map));
+    }
+
     if (fox_alloc_options == NULL)
         return;
     const char *opts = fox_alloc_options;
@@ -360,8 +704,14 @@ static void _fox_alloc_init()
         switch (*fox_alloc_options) {
         case 'C':
             alloc_flags |= CANARY;
+            canary_size = _parse_num(&fox_alloc_options, CANARY_SIZE);
+            if (fox_alloc_options[1] == '-') {
+                alloc_flags |= LAZYCHECK;
+                fox_alloc_options++;
+            }
             break;
         case 'D':
+            alloc_flags |= DUMP;
             atexit(_fox_alloc_dump);
             break;
         case '+':
@@ -381,9 +731,24 @@ static void _fox_alloc_init()
         case 'F':
             alloc_flags |= FCHECK;
             break;
+        case 'H':
+            alloc_flags |= MMAP | HUGEPAGE;
+            break;
+        case 'M':
+            alloc_flags |= MMAP;
+            mmap_threshold = _parse_num(&fox_alloc_options, MMAP_THRESHOLD);
+            break;
+        case 'P':
+            alloc_flags |= PROFILE;
+            _fox_profile_init(_parse_num(&fox_alloc_options,
+                SAMPLE_INTERVAL));
+            break;
         case 'Q':
             alloc_flags &= ~LOUD;
             break;
+        case 'S':
+            alloc_flags |= SLAB;
+            break;
         case 'V':
             alloc_flags |= VERBOSE;
             break;
@@ -400,139 +765,185 @@ static void _fox_alloc_init()
     }
 }
 
-static void _fox_alloc_dump()
+/* canaries are all zero bytes, OR them together a vector at a time */
+static bool _canary_ok(const u8 *canary, usize n)
 {
-    int magic = 0, screaming = 0;
+    usize i = 0;
 
-    FILE *dump_file = fopen("memdump.foxstd", "w");
-    if (alloc_flags & DUMPC)
-        magic = 1;
+#ifdef __SSE2__
+    __m128i acc = _mm_setzero_si128();
 
-    fwrite(&magic, sizeof(int), 1, dump_file);
+    for (; i + 16 <= n; i += 16)
+        acc = _mm_or_si128(acc, _mm_loadu_si128((const void*) (canary + i)));
 
-    for (usize i = 0; i < table.cap; i++) {
-        struct _hashmap_pair *it = table.pairs + i;
-        if (it->state == VALID && !it->value.freed) {
-            struct foxptr *ptr = it->key;
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) != 0xFFFF)
+        return false;
+#endif
 
-            if (alloc_flags & LOUD) {
-                screaming = 1;
-                u8 *data = ptr->data;
-                for (usize j = 0; j < ptr->allocated; j++) {
-                    if (data[j] != 0xAA) {
-                        screaming = 0;
-                        break;
-                    }
-                }
-            }
+    u64 word = 0, tmp;
 
-            /* screaming, address, size, content */
+    for (; i + sizeof(u64) <= n; i += sizeof(u64)) {
+        memcpy(&tmp, canary + i, sizeof(u64));
+        word |= tmp;
+    }
 
-            void **addr = (void*) &ptr->data;
+    for (; i < n; i++)
+        word |= canary[i];
 
-            fwrite(&screaming, sizeof(int), 1, dump_file);
-            fwrite(&addr, sizeof(void*), 1, dump_file);
-            fwrite(&ptr->allocated, sizeof(usize), 1, dump_file);
+    return word == 0;
+}
 
-            if (magic)
-                fwrite(ptr->data, sizeof(u8), ptr->allocated, dump_file);
-        }
-    }
+static void _check_block(struct foxptr *ptr, void *data)
+{
+    struct _check_batch *batch = data;
 
-    fclose(dump_file);
+    if (ptr != NULL && !_canary_ok(ptr->data + ptr->allocated, canary_size)) {
+        fprintf(stderr, "*** heap smashing detected ***: pointer %p\n",
+            (void*) ptr->data);
+        batch->ok = false;
+    }
 }
 
-/* private hashmap start */
-static u32 _djb2(const void *bytes, usize len)
+static void *_check_shards(void *data)
 {
-    const u8 *ptr = bytes;
-    u32 hash = 5381;
-    for (usize i = 0; i < len; ++i)
-        hash = hash * 33 + ptr[i];
+    struct _check_batch *batch = data;
+
+    _fox_track_each(batch->first, batch->step, _check_block, batch);
 
-    return hash;
+    return NULL;
 }
 
-static usize hashmap_insert(struct _hashmap *hm, void *key,
-    struct _allocation_info *info)
+/* reads the digits following an option, leaving opts on the last one */
+static usize _parse_num(const char **opts, usize fallback)
 {
-    if (!hashmap_resize(hm))
-        return hm->cap;
+    const char *it = *opts + 1;
+    usize num = 0;
 
-    size_t it = _djb2(&key, sizeof(void*)) % hm->cap;
+    if (*it < '0' || *it > '9')
+        return fallback;
 
-    while (hm->pairs[it].state == VALID && memcmp(&key, &hm->pairs[it].key,
-        sizeof(void*)))
-        it = (it + 1) % hm->cap;
+    for (; *it >= '0' && *it <= '9'; it++)
+        num = num * 10 + (*it - '0');
 
-    if (hm->pairs[it].state != VALID)
-        hm->len += 1;
+    *opts = it - 1;
 
-    hm->pairs[it].state = VALID;
-    hm->pairs[it].key = key;
-    hm->pairs[it].value = *info;
+    return num;
+}
 
-    return it;
+static void _fox_alloc_dump()
+{
+    if (!fox_alloc_snapshot("memdump.foxstd"))
+        fprintf(stderr, "Warning: failed to write memdump.foxstd\n");
 }
 
-static usize hashmap_find(const struct _hashmap *hm, void *key)
+bool fox_alloc_snapshot(const char *path)
 {
-    if (hm->cap == 0)
-        return hm->cap;
+    pthread_once(&init_once, _fox_alloc_init);
+
+    if (!(alloc_flags & TRACK))
+        return false;
+
+    return _fox_dump(path, alloc_flags & DUMPC, alloc_flags & LOUD);
+}
 
-    usize it = _djb2(&key, sizeof(void*)) % hm->cap;
+/* private tracking table start */
+static u64 _mix(const void *key)
+{
+    u64 h = (u64) (uintptr_t) key;
 
-    while (hm->pairs[it].state == VALID && memcmp(&key, &hm->pairs[it].key,
-        sizeof(void*)))
-            it = (it + 1) % hm->cap;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
 
-    if (hm->pairs[it].state != VALID)
-        return hm->cap;
+    return h;
+}
 
-    return it;
+static u64 _track_hash(const void *key)
+{
+    return _mix(*(void* const*) key);
 }
 
-static void hashmap_remove(struct _hashmap *hm, size_t it)
+#define _shard_of(h) (table + ((h) >> 58))
+
+static void _shard_lock(struct _track_shard *shard)
 {
-    hm->pairs[it].state = DELETED;
-    hm->len -= 1;
-    hashmap_resize(hm);
+    while (__atomic_exchange_n(&shard->locked, true, __ATOMIC_ACQUIRE))
+        while (__atomic_load_n(&shard->locked, __ATOMIC_RELAXED))
+            sched_yield();
 }
 
-static bool hashmap_resize(struct _hashmap *hm)
+static void _shard_unlock(struct _track_shard *shard)
 {
-    size_t oldCap = hm->cap;
-    size_t newCap;
+    __atomic_store_n(&shard->locked, false, __ATOMIC_RELEASE);
+}
 
-    if (!hm->cap || hm->len * 4 > hm->cap * 3) {
-        newCap = oldCap > 0 ? oldCap * 2 : 128;
-    } else if (hm->cap > 128 && hm->len * 4 < hm->cap) {
-        newCap = oldCap / 2;
-    } else {
-        return true;
-    }
+static void track_insert(void *key, const struct _allocation_info *info)
+{
+    u64 h = _mix(key);
+    struct _track_shard *shard = _shard_of(h);
 
-    struct _hashmap_pair *new_pairs = calloc(newCap, sizeof(*new_pairs));
+    _shard_lock(shard);
+    _fox_map_insert_hashed(&shard->map, &key, info, h);
+    _shard_unlock(shard);
+}
 
-    if (!new_pairs)
-        return false;
+/* marks key as freed, returns false when it already was */
+static bool track_release(void *key, bool strict)
+{
+    u64 h = _mix(key);
+    struct _track_shard *shard = _shard_of(h);
+    bool ok = true;
+
+    _shard_lock(shard);
 
-    for (size_t i = 0; i < oldCap; ++i) {
-        if (hm->pairs[i].state != VALID)
-            continue;
-        size_t it = _djb2(&hm->pairs[i].key, sizeof(void*)) % newCap;
-        while (new_pairs[it].state == VALID)
-            it = (it + 1) % newCap;
+    struct _allocation_info *info = _fox_map_get_hashed(&shard->map, &key,
+        h);
 
-        new_pairs[it].state = VALID;
-        new_pairs[it].key = hm->pairs[i].key;
-        new_pairs[it].value = hm->pairs[i].value;
+    if (info != NULL) {
+        ok = !(strict && info->freed);
+        info->freed = true;
     }
 
-    free(hm->pairs);
-    hm->pairs = new_pairs;
-    hm->cap = newCap;
+    _shard_unlock(shard);
+
+    return ok;
+}
+
+static bool track_remove(void *key, struct _allocation_info *info)
+{
+    u64 h = _mix(key);
+    struct _track_shard *shard = _shard_of(h);
+
+    _shard_lock(shard);
+    bool found = _fox_map_remove_hashed(&shard->map, &key, info, h);
+    _shard_unlock(shard);
+
+    return found;
+}
+
+/*
+ * Calls fn on every live block of the shards first, first + step, ... with
+ * the shard locked, then once with NULL before the shard is unlocked.
+ */
+void _fox_track_each(usize first, usize step,
+    void (*fn)(struct foxptr *ptr, void *ctx), void *ctx)
+{
+    for (usize s = first; s < TRACK_SHARDS; s += step) {
+        struct _track_shard *shard = table + s;
+        void *key, *value;
 
-    return true;
+        _shard_lock(shard);
+
+        for (usize it = 0; fox_map_next(&shard->map, &it, &key, &value);) {
+            struct _allocation_info *info = value;
+            if (!info->freed)
+                fn(*(struct foxptr**) key, ctx);
+        }
+
+        fn(NULL, ctx);
+        _shard_unlock(shard);
+    }
 }
-/* private hashmap end */
+/* private tracking table end */
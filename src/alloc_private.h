@@ -0,0 +1,122 @@
+#pragma once
+
+#include <num.h>
+#include <alloc.h>
+#include <map.h>
+
+/*
+ * Every fox allocation is laid out as
+ *
+ *      [tag][allocated][data...][canary]
+ *
+ * tag is a private word telling which backend owns the block, so struct
+ * foxptr and fox_visualize keep their public layout. Blocks from malloc
+ * may start before tag when they were padded for alignment, the padding is
+ * kept in the value bits. data is always at least FOX_ALIGN aligned.
+ */
+#define FOX_HDR_SIZE    (sizeof(usize) + sizeof(struct foxptr))
+#define FOX_ALIGN       16
+#define fox_tag(p)      (((usize*) (p))[-1])
+#define fox_base(p)     ((void*) &fox_tag(p))
+
+enum fox_kind {
+    FOX_HEAP = 0,
+    FOX_SLAB = 1,
+    FOX_ARENA = 2,
+    FOX_INLINE = 3,     /* caller storage, value is its usable size */
+    FOX_FILE = 4,       /* the items of a file mapped by fox_vec_map */
+    FOX_MMAP = 5,       /* anonymous mapping, value is the offset into it */
+};
+
+#define FOX_TAG_KIND    0x7
+#define FOX_TAG_SAMPLED 0x8
+#define FOX_TAG_ALIGN   0xF0
+#define FOX_TAG_SHIFT   8
+
+#define fox_tag_make(kind, value) (((usize) (value) << FOX_TAG_SHIFT) | (kind))
+#define fox_tag_kind(tag)   ((tag) & FOX_TAG_KIND)
+#define fox_tag_value(tag)  ((tag) >> FOX_TAG_SHIFT)
+
+/* log2 of the alignment requested for the block, 0 for FOX_ALIGN */
+#define fox_tag_align(tag)          (((tag) & FOX_TAG_ALIGN) >> 4)
+#define fox_tag_align_make(shift)   ((usize) (shift) << 4)
+
+/* alloc.c */
+void*   _fox_raw_alloc(usize size);
+void    _fox_raw_free(void *ptr);
+void    _fox_alloc_setup();
+usize   _fox_canary_size();
+bool    _fox_alloc_tracked();
+bool    _fox_alloc_profiled();
+void    _fox_track_each(usize first, usize step,
+            void (*fn)(struct foxptr *ptr, void *ctx), void *ctx);
+
+/*
+ * Canary, loud fill and tracking for a block handed out by any backend.
+ * Releasing a block that is already marked freed only aborts when strict.
+ */
+void    _fox_block_init(struct foxptr *ptr, bool zero);
+void    _fox_block_release(struct foxptr *ptr, bool strict);
+
+/* slab.c */
+#define FOX_SLAB_CLASSES    31
+#define FOX_SLAB_MAX        8192
+
+i32     _fox_slab_class(usize total);
+usize   _fox_slab_size(i32 cls);
+void*   _fox_slab_alloc(i32 cls);
+void    _fox_slab_free(void *block, i32 cls);
+
+/* map.c, a fox_map whose table is taken from malloc instead of fox_alloc */
+struct fox_map  _fox_map_new_raw(const usize keysize, const usize valuesize,
+                    hasher *hash, comparar *equals);
+/* the same operations with the hash of key already at hand */
+void*           _fox_map_insert_hashed(struct fox_map *map, const void *key,
+                    const void *value, u64 h);
+void*           _fox_map_get_hashed(const struct fox_map *map,
+                    const void *key, u64 h);
+bool            _fox_map_remove_hashed(struct fox_map *map, const void *key,
+                    void *value, u64 h);
+
+/* dump.c */
+bool    _fox_dump(const char *path, bool content, bool loud);
+
+/* stats.c */
+void    _fox_stats_alloc(usize size);
+void    _fox_stats_free(usize count, usize size);
+void    _fox_stats_realloc(usize old_size, usize new_size, bool moved);
+
+/* profile.c */
+void    _fox_profile_init(usize interval);
+void    _fox_profile_alloc(struct foxptr *ptr);
+void    _fox_profile_free(struct foxptr *ptr);
+/*
+ * For a block that may survive, as on a realloc: detach takes its sample out
+ * of the live bytes, reattach puts it back and drop forgets it.
+ */
+void*   _fox_profile_detach(struct foxptr *ptr);
+void    _fox_profile_reattach(struct foxptr *ptr, void *sample);
+void    _fox_profile_drop(void *sample);
+
+/* arena.c, arena blocks keep their arena in the word before the tag */
+#define fox_arena_of(p) (((struct fox_arena**) (p))[-2])
+
+struct foxptr  *_fox_arena_realloc(struct foxptr *ptr, usize new_size);
+void            _fox_arena_free(struct foxptr *ptr);
+
+/*
+ * mapped.c, file blocks are not tracked, counted or given canaries, they
+ * are resized and unmapped here directly
+ */
+struct foxptr  *_fox_file_realloc(struct foxptr *ptr, usize new_size);
+void            _fox_file_free(struct foxptr *ptr);
+
+/*
+ * mapped.c, blocks of their own anonymous mapping. extra is the canary
+ * size, which the mapping length depends on.
+ */
+struct foxptr  *_fox_mmap_alloc(usize size, usize extra, usize shift,
+                    bool huge);
+struct foxptr  *_fox_mmap_realloc(struct foxptr *ptr, usize new_size,
+                    usize extra);
+void            _fox_mmap_free(struct foxptr *ptr, usize extra);
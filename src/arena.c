@@ -0,0 +1,258 @@
+#include <num.h>
+#include <alloc.h>
+#include <arena.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc_private.h"
+
+#define ARENA_ALIGN     16
+#define ARENA_PREFIX    (sizeof(struct fox_arena*) + FOX_HDR_SIZE)
+#define ARENA_DEFAULT   (64 * 1024)
+
+#define _align(n)       (((n) + ARENA_ALIGN - 1) & ~((usize) ARENA_ALIGN - 1))
+#define _block_data(b)  ((u8*) (b) + _align(sizeof(struct _arena_block)))
+
+/*
+ * Every allocation inside a block is laid out as
+ *
+ *      [arena][tag][allocated][data...][canary]
+ *
+ * with data aligned to ARENA_ALIGN, so the objects of a block can be walked
+ * from its start when the debug options need to visit them.
+ */
+struct _arena_block {
+    struct _arena_block *next;
+    usize cap;
+    usize used;
+};
+
+struct fox_arena {
+    struct _arena_block *first;
+    struct _arena_block *current;
+    usize block_size;
+    usize count;    /* live allocations, for fox_alloc_stats */
+    usize bytes;
+};
+
+static struct _arena_block *_block_new(usize cap);
+static struct foxptr       *_arena_bump(struct fox_arena *arena, usize size);
+static void                 _arena_release(struct _arena_block *block,
+                                usize from);
+
+struct fox_arena *fox_arena_new(usize block_size)
+{
+    _fox_alloc_setup();
+
+    struct fox_arena *arena = _fox_raw_alloc(sizeof(*arena));
+    if (arena == NULL)
+        return NULL;
+
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT;
+    arena->count = 0;
+    arena->bytes = 0;
+    arena->first = _block_new(arena->block_size);
+    arena->current = arena->first;
+
+    if (arena->first == NULL) {
+        _fox_raw_free(arena);
+        return NULL;
+    }
+
+    return arena;
+}
+
+void fox_arena_del(struct fox_arena *arena)
+{
+    if (arena == NULL)
+        return;
+
+    fox_arena_reset(arena);
+
+    struct _arena_block *block = arena->first;
+    while (block != NULL) {
+        struct _arena_block *next = block->next;
+        _fox_raw_free(block);
+        block = next;
+    }
+
+    _fox_raw_free(arena);
+}
+
+void *fox_arena_alloc(struct fox_arena *arena, usize size)
+{
+    struct foxptr *ptr = _arena_bump(arena, size);
+    if (ptr == NULL)
+        return NULL;
+
+    _fox_block_init(ptr, false);
+    arena->count++;
+    arena->bytes += size;
+
+    return ptr->data;
+}
+
+void *fox_arena_alloczero(struct fox_arena *arena, usize size)
+{
+    struct foxptr *ptr = _arena_bump(arena, size);
+    if (ptr == NULL)
+        return NULL;
+
+    memset(ptr->data, 0, size);
+    _fox_block_init(ptr, true);
+    arena->count++;
+    arena->bytes += size;
+
+    return ptr->data;
+}
+
+void fox_arena_reset(struct fox_arena *arena)
+{
+    struct fox_arena_mark mark = { arena->first, 0, 0, 0 };
+    fox_arena_restore(arena, mark);
+}
+
+struct fox_arena_mark fox_arena_save(const struct fox_arena *arena)
+{
+    struct fox_arena_mark mark = { arena->current, arena->current->used,
+        arena->count, arena->bytes };
+    return mark;
+}
+
+/* blocks past the mark are kept around and reused by later allocations */
+void fox_arena_restore(struct fox_arena *arena, struct fox_arena_mark mark)
+{
+    struct _arena_block *block = mark.block;
+
+    /* only the debug options need to see the objects go */
+    if (_fox_canary_size() || _fox_alloc_tracked() || _fox_alloc_profiled()) {
+        _arena_release(block, mark.used);
+        for (struct _arena_block *it = block->next; it != NULL &&
+            it != arena->current->next; it = it->next)
+            _arena_release(it, 0);
+    }
+
+    _fox_stats_free(arena->count - mark.count, arena->bytes - mark.bytes);
+
+    block->used = mark.used;
+    arena->current = block;
+    arena->count = mark.count;
+    arena->bytes = mark.bytes;
+}
+
+struct foxptr *_fox_arena_realloc(struct foxptr *ptr, usize new_size)
+{
+    struct fox_arena *arena = fox_arena_of(ptr);
+    struct _arena_block *block = arena->current;
+    usize canary = _fox_canary_size();
+    u8 *end = ptr->data + ptr->allocated + canary;
+
+    arena->bytes += new_size - ptr->allocated;
+
+    /* the last allocation of the arena grows in place */
+    if (end == _block_data(block) + block->used &&
+        (usize) (ptr->data - _block_data(block)) + new_size + canary <=
+        block->cap) {
+        block->used = (ptr->data - _block_data(block)) + new_size + canary;
+        ptr->allocated = new_size;
+        return ptr;
+    }
+
+    struct foxptr *next = _arena_bump(arena, new_size);
+    if (next == NULL) {
+        arena->bytes -= new_size - ptr->allocated;
+        return NULL;
+    }
+
+    memcpy(next->data, ptr->data, ptr->allocated < new_size ?
+        ptr->allocated : new_size);
+
+    return next;
+}
+
+void _fox_arena_free(struct foxptr *ptr)
+{
+    struct fox_arena *arena = fox_arena_of(ptr);
+    struct _arena_block *block = arena->current;
+    u8 *end = ptr->data + ptr->allocated + _fox_canary_size();
+
+    arena->count--;
+    arena->bytes -= ptr->allocated;
+
+    if (end == _block_data(block) + block->used)
+        block->used = (ptr->data - _block_data(block)) - ARENA_PREFIX;
+}
+
+static struct _arena_block *_block_new(usize cap)
+{
+    struct _arena_block *block = _fox_raw_alloc(
+        _align(sizeof(struct _arena_block)) + cap);
+
+    if (block == NULL)
+        return NULL;
+
+    block->next = NULL;
+    block->cap = cap;
+    block->used = 0;
+
+    return block;
+}
+
+static struct foxptr *_arena_bump(struct fox_arena *arena, usize size)
+{
+    usize canary = _fox_canary_size();
+    struct _arena_block *block = arena->current;
+    usize offset = _align(block->used + ARENA_PREFIX);
+
+    if (size > block->cap || offset + size + canary > block->cap) {
+        usize need = ARENA_PREFIX + ARENA_ALIGN + size + canary;
+        if (need < size)
+            return NULL;
+
+        struct _arena_block *next = block->next;
+
+        if (next == NULL || next->cap < need) {
+            next = _block_new(need > arena->block_size ?
+                need : arena->block_size);
+            if (next == NULL)
+                return NULL;
+
+            next->next = block->next;
+            block->next = next;
+        }
+
+        next->used = 0;
+        block = next;
+        arena->current = block;
+        offset = _align(ARENA_PREFIX);
+    }
+
+    struct foxptr *ptr = (void*) (_block_data(block) + offset -
+        sizeof(struct foxptr));
+
+    fox_arena_of(ptr) = arena;
+    fox_tag(ptr) = fox_tag_make(FOX_ARENA, 0);
+    ptr->allocated = size;
+    block->used = offset + size + canary;
+
+    return ptr;
+}
+
+/* runs the free-time checks on every object of block starting at from */
+static void _arena_release(struct _arena_block *block, usize from)
+{
+    usize canary = _fox_canary_size();
+    usize offset = from;
+
+    while (offset < block->used) {
+        offset = _align(offset + ARENA_PREFIX);
+
+        struct foxptr *ptr = (void*) (_block_data(block) + offset -
+            sizeof(struct foxptr));
+
+        _fox_block_release(ptr, false);
+        offset += ptr->allocated + canary;
+    }
+}
@@ -0,0 +1,179 @@
+#include <alloc.h>
+#include <assert.h>
+#include <string.h>
+#include <utils.h>
+#include <num.h>
+#include <fns.h>
+#include <deque.h>
+
+#define DEQUE_MIN   16
+
+static bool _grow(struct fox_deque *dq, const usize extra);
+
+static inline u8 *_slot(const struct fox_deque *dq, const usize index)
+{
+    return (u8*) dq->items +
+        ((dq->head + index) & (dq->capacity - 1)) * dq->chunksize;
+}
+
+struct fox_deque fox_deque_new(const usize chunksize)
+{
+    assert(chunksize > 0);
+    struct fox_deque dq = { .chunksize = chunksize, 0 };
+    dq.items = fox_reallocarray(dq.items, DEQUE_MIN, chunksize);
+    dq.capacity = dq.items != NULL ? DEQUE_MIN : 0;
+    return dq;
+}
+
+void fox_deque_del(struct fox_deque *dq, deletor *deletor)
+{
+    assert(dq != NULL);
+
+    fox_deque_clear(dq, deletor);
+    fox_free(dq->items);
+    dq->items = NULL;
+    dq->capacity = 0;
+}
+
+void fox_deque_push_back(struct fox_deque *dq, const void *data)
+{
+    assert(dq != NULL);
+    assert(data != NULL);
+
+    if (!_grow(dq, 1))
+        return;
+
+    memcpy(_slot(dq, dq->size), data, dq->chunksize);
+    dq->size++;
+}
+
+void fox_deque_push_front(struct fox_deque *dq, const void *data)
+{
+    assert(dq != NULL);
+    assert(data != NULL);
+
+    if (!_grow(dq, 1))
+        return;
+
+    dq->head = (dq->head - 1) & (dq->capacity - 1);
+    memcpy(_slot(dq, 0), data, dq->chunksize);
+    dq->size++;
+}
+
+void fox_deque_pop_back(struct fox_deque *dq, deletor *deletor)
+{
+    assert(dq != NULL);
+    if (dq->size == 0)
+        return;
+
+    if (deletor != NULL)
+        deletor(_slot(dq, dq->size - 1));
+
+    dq->size--;
+}
+
+void fox_deque_pop_front(struct fox_deque *dq, deletor *deletor)
+{
+    assert(dq != NULL);
+    if (dq->size == 0)
+        return;
+
+    if (deletor != NULL)
+        deletor(_slot(dq, 0));
+
+    dq->head = (dq->head + 1) & (dq->capacity - 1);
+    dq->size--;
+}
+
+void *fox_deque_front(const struct fox_deque *dq)
+{
+    return fox_deque_get(dq, 0);
+}
+
+void *fox_deque_back(const struct fox_deque *dq)
+{
+    assert(dq != NULL);
+    if (dq->size == 0)
+        return NULL;
+
+    return _slot(dq, dq->size - 1);
+}
+
+void *fox_deque_get(const struct fox_deque *dq, const usize index)
+{
+    assert(dq != NULL);
+    if (index >= dq->size)
+        return NULL;
+
+    return _slot(dq, index);
+}
+
+void fox_deque_clear(struct fox_deque *dq, deletor *deletor)
+{
+    assert(dq != NULL);
+
+    for (usize i = 0; deletor != NULL && i < dq->size; i++)
+        deletor(_slot(dq, i));
+
+    dq->size = 0;
+    dq->head = 0;
+}
+
+void fox_deque_reserve(struct fox_deque *dq, const usize capacity)
+{
+    assert(dq != NULL);
+
+    if (capacity > dq->size)
+        _grow(dq, capacity - dq->size);
+}
+
+bool fox_deque_is_empty(const struct fox_deque *dq)
+{
+    return dq->size == 0;
+}
+
+/*
+ * The buffer is reallocated to the next power of two, which keeps the
+ * items in the low half. When they wrap around the old end, the shorter of
+ * the two pieces moves: the wrapped start right after the old end, or the
+ * front up against the new end.
+ */
+static bool _grow(struct fox_deque *dq, const usize extra)
+{
+    usize needed = dq->size + extra;
+    usize old = dq->capacity, cap = old ? old : DEQUE_MIN;
+
+    if (needed < dq->size)
+        return false;
+
+    if (old >= needed)
+        return true;
+
+    while (cap < needed) {
+        if (cap * 2 < cap)
+            return false;
+        cap *= 2;
+    }
+
+    u8 *items = fox_reallocarray(dq->items, cap, dq->chunksize);
+    if (items == NULL)
+        return false;
+
+    usize size = dq->chunksize;
+
+    if (dq->head + dq->size > old) {
+        usize front = old - dq->head, wrapped = dq->size - front;
+
+        if (wrapped <= front) {
+            fox_memcopy(items + old * size, items, wrapped * size);
+        } else {
+            fox_memcopy(items + (cap - front) * size,
+                items + dq->head * size, front * size);
+            dq->head = cap - front;
+        }
+    }
+
+    dq->items = items;
+    dq->capacity = cap;
+    return true;
+}
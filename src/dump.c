@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <num.h>
+#include <alloc.h>
+#include <dump.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "alloc_private.h"
+
+#define DUMP_IOV 512     /* below IOV_MAX everywhere */
+
+/*
+ * Block contents go straight from the heap to the file with writev, a batch
+ * at a time while the shard holding them is locked. The index is built in
+ * memory and written once at the end.
+ */
+struct _dump {
+    int fd;
+    bool content;
+    bool loud;
+    bool failed;
+    u64 offset;
+    struct fox_dump_entry *index;
+    usize count;
+    usize cap;
+    struct iovec iov[DUMP_IOV];
+    int iovcnt;
+};
+
+static void _dump_block(struct foxptr *ptr, void *ctx);
+static void _dump_flush(struct _dump *d);
+static bool _write_all(int fd, const void *data, usize n);
+static int  _compare(const void *a, const void *b);
+
+bool _fox_dump(const char *path, bool content, bool loud)
+{
+    struct _dump d = {0};
+    struct fox_dump_header header = {0};
+
+    d.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (d.fd < 0)
+        return false;
+
+    d.content = content;
+    d.loud = loud;
+    d.offset = sizeof(header);
+
+    if (lseek(d.fd, sizeof(header), SEEK_SET) < 0)
+        d.failed = true;
+
+    _fox_track_each(0, 1, _dump_block, &d);
+
+    /* readers use the index in place, so it starts on an 8 byte boundary */
+    static const u8 zeros[sizeof(u64)];
+    usize pad = -d.offset & (sizeof(u64) - 1);
+
+    if (!d.failed && !_write_all(d.fd, zeros, pad))
+        d.failed = true;
+    d.offset += pad;
+
+    qsort(d.index, d.count, sizeof(*d.index), _compare);
+
+    memcpy(header.magic, FOX_DUMP_MAGIC, sizeof(FOX_DUMP_MAGIC));
+    header.version = FOX_DUMP_VERSION;
+    header.flags = content ? FOX_DUMP_CONTENT : 0;
+    header.count = d.count;
+    header.index = d.offset;
+
+    if (!d.failed)
+        d.failed = !_write_all(d.fd, d.index, d.count * sizeof(*d.index)) ||
+            pwrite(d.fd, &header, sizeof(header), 0) != sizeof(header);
+
+    free(d.index);
+
+    return close(d.fd) == 0 && !d.failed;
+}
+
+static void _dump_block(struct foxptr *ptr, void *ctx)
+{
+    struct _dump *d = ctx;
+
+    /* end of a shard, its blocks may go away once it is unlocked */
+    if (ptr == NULL) {
+        _dump_flush(d);
+        return;
+    }
+
+    if (d->count == d->cap) {
+        usize cap = d->cap ? d->cap * 2 : 1024;
+        struct fox_dump_entry *index = realloc(d->index, cap * sizeof(*index));
+
+        if (index == NULL) {
+            d->failed = true;
+            return;
+        }
+
+        d->index = index;
+        d->cap = cap;
+    }
+
+    struct fox_dump_entry *entry = d->index + d->count++;
+    memset(entry, 0, sizeof(*entry));
+    entry->address = (u64) (uintptr_t) ptr->data;
+    entry->size = ptr->allocated;
+
+    if (d->loud) {
+        entry->screaming = 1;
+        for (usize i = 0; i < ptr->allocated; i++) {
+            if (ptr->data[i] != 0xAA) {
+                entry->screaming = 0;
+                break;
+            }
+        }
+    }
+
+    if (!d->content || ptr->allocated == 0)
+        return;
+
+    entry->offset = d->offset;
+    d->offset += ptr->allocated;
+    d->iov[d->iovcnt].iov_base = ptr->data;
+    d->iov[d->iovcnt].iov_len = ptr->allocated;
+
+    if (++d->iovcnt == DUMP_IOV)
+        _dump_flush(d);
+}
+
+static void _dump_flush(struct _dump *d)
+{
+    struct iovec *iov = d->iov;
+    int left = d->iovcnt;
+
+    d->iovcnt = 0;
+
+    while (left > 0 && !d->failed) {
+        ssize_t n = writev(d->fd, iov, left);
+
+        if (n < 0) {
+            d->failed = true;
+            return;
+        }
+
+        /* skip what was written, partial writes resume mid-block */
+        while (left > 0 && (usize) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            left--;
+        }
+
+        if (left > 0) {
+            iov->iov_base = (u8*) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+static bool _write_all(int fd, const void *data, usize n)
+{
+    const u8 *it = data;
+
+    while (n > 0) {
+        ssize_t written = write(fd, it, n);
+        if (written < 0)
+            return false;
+
+        it += written;
+        n -= written;
+    }
+
+    return true;
+}
+
+static int _compare(const void *a, const void *b)
+{
+    const struct fox_dump_entry *x = a, *y = b;
+
+    return (x->address > y->address) - (x->address < y->address);
+}
@@ -0,0 +1,458 @@
+#include <num.h>
+#include <alloc.h>
+#include <map.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "alloc_private.h"
+
+#define GROUP           16
+#define MAP_MIN         16
+#define CTRL_EMPTY      0x80    /* has the high bit, full slots do not */
+
+static u64  _hash(const struct fox_map *map, const void *key);
+static bool _rehash(struct fox_map *map, usize capacity);
+static void _erase(struct fox_map *map, usize hole);
+
+/*
+ * Bit i of each mask is slot i of the group. Groups start on a multiple of
+ * GROUP in the control bytes, which are GROUP aligned themselves.
+ */
+#ifdef __SSE2__
+static inline u32 _match(const u8 *group, u8 h2)
+{
+    __m128i ctrl = _mm_load_si128((const __m128i*) group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+}
+
+static inline u32 _match_empty(const u8 *group)
+{
+    return _match(group, CTRL_EMPTY);
+}
+
+static inline u32 _match_free(const u8 *group)
+{
+    return _mm_movemask_epi8(_mm_load_si128((const __m128i*) group));
+}
+#else
+static inline u32 _match(const u8 *group, u8 h2)
+{
+    u32 mask = 0;
+
+    for (u32 i = 0; i < GROUP; i++)
+        mask |= (u32) (group[i] == h2) << i;
+
+    return mask;
+}
+
+static inline u32 _match_empty(const u8 *group)
+{
+    return _match(group, CTRL_EMPTY);
+}
+
+static inline u32 _match_free(const u8 *group)
+{
+    u32 mask = 0;
+
+    for (u32 i = 0; i < GROUP; i++)
+        mask |= (u32) (group[i] >> 7) << i;
+
+    return mask;
+}
+#endif
+
+static inline u8 *_key(const struct fox_map *map, usize slot)
+{
+    return map->slots + slot * map->stride;
+}
+
+static inline u8 *_value(const struct fox_map *map, usize slot)
+{
+    return map->slots + slot * map->stride + map->offset;
+}
+
+static inline bool _equal(const struct fox_map *map, const void *a,
+    const void *b)
+{
+    if (map->equals != NULL)
+        return map->equals(a, b);
+
+    /* pointer and integer keys, without a call to memcmp */
+    if (map->keysize == sizeof(u64)) {
+        u64 x, y;
+        memcpy(&x, a, sizeof(x));
+        memcpy(&y, b, sizeof(y));
+        return x == y;
+    }
+
+    return memcmp(a, b, map->keysize) == 0;
+}
+
+/* largest power of two dividing n, at most 16 */
+static inline usize _align_of(usize n)
+{
+    usize align = n & -n;
+    return align == 0 || align > 16 ? 16 : align;
+}
+
+/* usable entries of a table with capacity slots */
+static inline usize _max_load(usize capacity)
+{
+    return capacity - capacity / 8;
+}
+
+struct fox_map fox_map_new(const usize keysize, const usize valuesize,
+    hasher *hash, comparar *equals)
+{
+    assert(keysize > 0);
+
+    usize ka = _align_of(keysize), va = _align_of(valuesize);
+    usize align = ka > va ? ka : va;
+    usize offset = (keysize + va - 1) / va * va;
+    struct fox_map map = { keysize, valuesize, 0, 0, NULL, NULL, 0, offset,
+        0, hash, equals, false };
+
+    map.stride = (offset + valuesize + align - 1) / align * align;
+
+    return map;
+}
+
+/* a map whose table comes straight from malloc, for the allocator itself */
+struct fox_map _fox_map_new_raw(const usize keysize, const usize valuesize,
+    hasher *hash, comparar *equals)
+{
+    struct fox_map map = fox_map_new(keysize, valuesize, hash, equals);
+
+    map.raw = true;
+    return map;
+}
+
+static void _table_free(struct fox_map *map)
+{
+    if (map->raw)
+        free(map->ctrl);
+    else
+        fox_free(map->ctrl);
+}
+
+void fox_map_del(struct fox_map *map, deletor *key_deletor,
+    deletor *value_deletor)
+{
+    assert(map != NULL);
+
+    if (key_deletor != NULL || value_deletor != NULL) {
+        void *key, *value;
+
+        for (usize it = 0; fox_map_next(map, &it, &key, &value);) {
+            if (key_deletor != NULL)
+                key_deletor(key);
+            if (value_deletor != NULL)
+                value_deletor(value);
+        }
+    }
+
+    _table_free(map);
+    map->ctrl = map->slots = NULL;
+    map->size = map->capacity = map->growth = 0;
+}
+
+bool fox_map_reserve(struct fox_map *map, const usize count)
+{
+    assert(map != NULL);
+
+    usize capacity = MAP_MIN;
+
+    if (map->capacity != 0 && count <= map->size + map->growth)
+        return true;
+
+    while (_max_load(capacity) < count)
+        capacity *= 2;
+
+    return _rehash(map, capacity);
+}
+
+/*
+ * Groups are visited one after the other from the one h points at. The
+ * first group with an empty slot ends the search, the key cannot be past it:
+ * a key always lands in the first group of its probe with room, and removal
+ * keeps every group a key was probed past full.
+ */
+static isize _find(const struct fox_map *map, const void *key, u64 h)
+{
+    if (map->capacity == 0)
+        return -1;
+
+    usize mask = map->capacity / GROUP - 1, g = (h >> 7) & mask;
+    u8 h2 = h & 0x7F;
+
+    for (;;) {
+        const u8 *group = map->ctrl + g * GROUP;
+
+        for (u32 m = _match(group, h2); m != 0; m &= m - 1) {
+            usize slot = g * GROUP + __builtin_ctz(m);
+
+            if (_equal(map, _key(map, slot), key))
+                return slot;
+        }
+
+        if (_match_empty(group))
+            return -1;
+
+        g = (g + 1) & mask;
+    }
+}
+
+/* first empty slot on the probe sequence of h */
+static usize _free_slot(const struct fox_map *map, u64 h)
+{
+    usize mask = map->capacity / GROUP - 1, g = (h >> 7) & mask;
+
+    for (;;) {
+        u32 m = _match_empty(map->ctrl + g * GROUP);
+
+        if (m != 0)
+            return g * GROUP + __builtin_ctz(m);
+
+        g = (g + 1) & mask;
+    }
+}
+
+void *fox_map_insert(struct fox_map *map, const void *key, const void *value)
+{
+    assert(map != NULL && key != NULL);
+
+    return _fox_map_insert_hashed(map, key, value, _hash(map, key));
+}
+
+void *_fox_map_insert_hashed(struct fox_map *map, const void *key,
+    const void *value, u64 h)
+{
+    isize slot = _find(map, key, h);
+
+    if (slot < 0) {
+        /* past 7/8 full the table doubles */
+        if (map->growth == 0 && !_rehash(map, map->capacity ?
+            map->capacity * 2 : MAP_MIN))
+            return NULL;
+
+        slot = _free_slot(map, h);
+        map->growth--;
+
+        map->ctrl[slot] = h & 0x7F;
+        memcpy(_key(map, slot), key, map->keysize);
+        map->size++;
+    }
+
+    if (value != NULL)
+        memcpy(_value(map, slot), value, map->valuesize);
+
+    return _value(map, slot);
+}
+
+void *fox_map_get(const struct fox_map *map, const void *key)
+{
+    assert(map != NULL && key != NULL);
+
+    return _fox_map_get_hashed(map, key, _hash(map, key));
+}
+
+void *_fox_map_get_hashed(const struct fox_map *map, const void *key, u64 h)
+{
+    isize slot = _find(map, key, h);
+    return slot < 0 ? NULL : _value(map, slot);
+}
+
+bool fox_map_contains(const struct fox_map *map, const void *key)
+{
+    return fox_map_get(map, key) != NULL;
+}
+
+bool fox_map_remove(struct fox_map *map, const void *key, void *value)
+{
+    assert(map != NULL && key != NULL);
+
+    return _fox_map_remove_hashed(map, key, value, _hash(map, key));
+}
+
+bool _fox_map_remove_hashed(struct fox_map *map, const void *key,
+    void *value, u64 h)
+{
+    isize slot = _find(map, key, h);
+
+    if (slot < 0)
+        return false;
+
+    if (value != NULL)
+        memcpy(value, _value(map, slot), map->valuesize);
+
+    _erase(map, slot);
+    map->size--;
+    map->growth++;
+
+    return true;
+}
+
+/*
+ * Removal without tombstones. A search only goes past a group without empty
+ * slots, so emptying a slot of a full group would hide the keys probed past
+ * it. One of them is moved into the hole instead, which leaves a hole where
+ * it was, until the hole is in a group that had room already or no key was
+ * probed past it. Keys past the first group with room were never probed
+ * past the hole, only the groups up to it are searched.
+ */
+static void _erase(struct fox_map *map, usize hole)
+{
+    usize mask = map->capacity / GROUP - 1;
+
+    for (;;) {
+        usize g = hole / GROUP;
+        bool open = _match_empty(map->ctrl + g * GROUP) != 0;
+
+        map->ctrl[hole] = CTRL_EMPTY;
+        if (open)
+            return;
+
+        isize from = -1;
+
+        for (usize d = 1; d <= mask && from < 0; d++) {
+            usize y = (g + d) & mask;
+            const u8 *group = map->ctrl + y * GROUP;
+
+            /* a key of group y was probed past g when it started d back */
+            for (u32 m = ~_match_free(group) & 0xFFFF; m != 0; m &= m - 1) {
+                usize slot = y * GROUP + __builtin_ctz(m);
+                usize home = (_hash(map, _key(map, slot)) >> 7) & mask;
+
+                if (((y - home) & mask) >= d) {
+                    from = slot;
+                    break;
+                }
+            }
+
+            if (_match_empty(group))
+                break;
+        }
+
+        if (from < 0)
+            return;
+
+        map->ctrl[hole] = map->ctrl[from];
+        memcpy(_key(map, hole), _key(map, from), map->stride);
+        hole = from;
+    }
+}
+
+void fox_map_clear(struct fox_map *map)
+{
+    assert(map != NULL);
+
+    if (map->capacity == 0)
+        return;
+
+    memset(map->ctrl, CTRL_EMPTY, map->capacity);
+    map->size = 0;
+    map->growth = _max_load(map->capacity);
+}
+
+bool fox_map_next(const struct fox_map *map, usize *it, void **key,
+    void **value)
+{
+    assert(map != NULL && it != NULL);
+
+    for (usize i = *it; i < map->capacity;) {
+        usize g = i / GROUP * GROUP;
+        u32 full = ~_match_free(map->ctrl + g) & (0xFFFFu << (i - g)) &
+            0xFFFF;
+
+        if (full == 0) {
+            i = g + GROUP;
+            continue;
+        }
+
+        i = g + __builtin_ctz(full);
+        *it = i + 1;
+        if (key != NULL)
+            *key = _key(map, i);
+        if (value != NULL)
+            *value = _value(map, i);
+
+        return true;
+    }
+
+    *it = map->capacity;
+    return false;
+}
+
+/* 8 bytes at a time, finished with the murmur3 mix */
+u64 fox_hash(const void *data, usize size)
+{
+    const u8 *p = data;
+    u64 h = 0x9E3779B97F4A7C15ull ^ size, w;
+
+    for (; size >= 8; size -= 8, p += 8) {
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 31;
+    }
+
+    if (size > 0) {
+        w = 0;
+        memcpy(&w, p, size);
+        h = (h ^ w) * 0xBF58476D1CE4E5B9ull;
+    }
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+
+    return h;
+}
+
+static u64 _hash(const struct fox_map *map, const void *key)
+{
+    if (map->hash != NULL)
+        return map->hash(key);
+
+    return fox_hash(key, map->keysize);
+}
+
+/* moves every entry into a new table of capacity slots */
+static bool _rehash(struct fox_map *map, usize capacity)
+{
+    usize bytes = capacity + capacity * map->stride;
+    u8 *ctrl = map->raw ? malloc(bytes) : fox_alloc(bytes);
+
+    if (ctrl == NULL)
+        return false;
+
+    struct fox_map next = *map;
+
+    next.ctrl = ctrl;
+    next.slots = ctrl + capacity;
+    next.capacity = capacity;
+    next.growth = _max_load(capacity) - map->size;
+    memset(ctrl, CTRL_EMPTY, capacity);
+
+    void *key, *value;
+
+    for (usize it = 0; fox_map_next(map, &it, &key, &value);) {
+        u64 h = _hash(map, key);
+        usize slot = _free_slot(&next, h);
+
+        next.ctrl[slot] = h & 0x7F;
+        memcpy(_key(&next, slot), key, map->stride);
+    }
+
+    _table_free(map);
+    memcpy(map, &next, sizeof(*map));
+
+    return true;
+}
@@ -0,0 +1,318 @@
+#define _GNU_SOURCE
+
+#include <num.h>
+#include <alloc.h>
+#include <vec.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alloc_private.h"
+
+#define FILE_MAGIC  "foxvec1"
+#define FILE_DATA   64      /* offset of the items in the file */
+
+/*
+ * Start of a mapped vector file. The block header of the items follows
+ * right before FILE_DATA, so the items are an allocation like any other and
+ * fox_realloc and fox_free find their way back here.
+ */
+struct _file_header {
+    char magic[8];
+    u64 chunksize;
+    u64 size;       /* items, as of the last sync */
+    i64 fd;         /* while mapped, meaningless on disk */
+    u64 reserved[2];
+};
+
+static inline struct _file_header *_header(struct foxptr *p)
+{
+    return (void*) (p->data - FILE_DATA);
+}
+
+static inline struct foxptr *_block(void *base)
+{
+    return (void*) ((u8*) base + FILE_DATA - sizeof(struct foxptr));
+}
+
+static void *_map(int fd, usize len)
+{
+    void *base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return base == MAP_FAILED ? NULL : base;
+}
+
+struct fox_vec fox_vec_map(const char *path, const usize chunksize,
+    const int flags)
+{
+    assert(path != NULL);
+    assert(chunksize > 0);
+
+    struct fox_vec vec = { .chunksize = chunksize, 0 };
+    int fd = open(path, O_RDWR | O_CLOEXEC |
+        (flags & FOX_VEC_MAP_CREATE ? O_CREAT : 0), 0644);
+    struct stat st;
+
+    if (fd < 0)
+        return vec;
+
+    if (fstat(fd, &st) != 0 || chunksize > (SIZE_MAX - FILE_DATA) / 16)
+        goto fail;
+
+    usize len = st.st_size;
+    bool fresh = len == 0 || flags & FOX_VEC_MAP_TRUNCATE;
+
+    if (fresh) {
+        len = FILE_DATA + 16 * chunksize;
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, len) != 0)
+            goto fail;
+    } else if (len < FILE_DATA) {
+        errno = EINVAL;
+        goto fail;
+    }
+
+    struct _file_header *h = _map(fd, len);
+    if (h == NULL)
+        goto fail;
+
+    if (fresh) {
+        memcpy(h->magic, FILE_MAGIC, sizeof(h->magic));
+        h->chunksize = chunksize;
+        h->size = 0;
+    } else if (memcmp(h->magic, FILE_MAGIC, sizeof(h->magic)) != 0 ||
+        h->chunksize != chunksize ||
+        h->size > (len - FILE_DATA) / chunksize) {
+        munmap(h, len);
+        errno = EINVAL;
+        goto fail;
+    }
+
+    h->fd = fd;
+
+    struct foxptr *p = _block(h);
+    fox_tag(p) = fox_tag_make(FOX_FILE, 0);
+    p->allocated = len - FILE_DATA;
+
+    vec.items = p->data;
+    vec.size = h->size;
+
+    return vec;
+
+fail:
+    close(fd);
+    return vec;
+}
+
+bool fox_vec_is_mapped(const struct fox_vec *vec)
+{
+    assert(vec != NULL);
+
+    return vec->items != NULL &&
+        fox_tag_kind(fox_tag(fox_visualize(vec->items))) == FOX_FILE;
+}
+
+bool fox_vec_map_sync(struct fox_vec *vec, const bool wait)
+{
+    assert(vec != NULL);
+
+    if (!fox_vec_is_mapped(vec))
+        return false;
+
+    struct foxptr *p = fox_visualize(vec->items);
+    struct _file_header *h = _header(p);
+
+    h->size = vec->size;
+
+    return msync(h, FILE_DATA + p->allocated, wait ? MS_SYNC : MS_ASYNC) == 0;
+}
+
+bool fox_vec_map_advise(const struct fox_vec *vec, const usize start,
+    usize end, const int advice)
+{
+    assert(vec != NULL);
+
+    if (!fox_vec_is_mapped(vec))
+        return false;
+
+    struct foxptr *p = fox_visualize(vec->items);
+    usize capacity = p->allocated / vec->chunksize;
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+
+    if (end > capacity)
+        end = capacity;
+    if (start >= end)
+        return true;
+
+    /*
+     * madvise wants a page aligned start, but the page of the header is
+     * never advised, MADV_REMOVE and the like would lose it
+     */
+    uintptr_t first = ((uintptr_t) _header(p) + FILE_DATA + page - 1) &
+        ~(page - 1);
+    uintptr_t from = (uintptr_t) (p->data + start * vec->chunksize);
+    uintptr_t to = (uintptr_t) (p->data + end * vec->chunksize);
+
+    from &= ~(page - 1);
+    if (from < first)
+        from = first;
+    if (from >= to)
+        return true;
+
+    return madvise((void*) from, to - from, advice) == 0;
+}
+
+/*
+ * A growing file is extended before the mapping follows it, a shrinking one
+ * is cut after, so no page is ever mapped past its end. Without mremap the
+ * new mapping is made before the old one goes. On failure the mapping is
+ * left as it was, the file may have grown, which a later fox_vec_map takes
+ * as spare capacity.
+ */
+struct foxptr *_fox_file_realloc(struct foxptr *p, usize new_size)
+{
+    struct _file_header *h = _header(p);
+    usize old_len = FILE_DATA + p->allocated, new_len = FILE_DATA + new_size;
+    int fd = h->fd;
+
+    if (new_len < new_size)
+        return NULL;
+
+    if (new_len > old_len && ftruncate(fd, new_len) != 0)
+        return NULL;
+
+#ifdef MREMAP_MAYMOVE
+    void *base = mremap(h, old_len, new_len, MREMAP_MAYMOVE);
+    if (base == MAP_FAILED)
+        return NULL;
+#else
+    void *base = _map(fd, new_len);
+    if (base == NULL)
+        return NULL;
+    munmap(h, old_len);
+#endif
+
+    if (new_len < old_len && ftruncate(fd, new_len) != 0) {
+        /* still correct, only the file keeps its old length */
+    }
+
+    struct foxptr *next = _block(base);
+    next->allocated = new_size;
+
+    return next;
+}
+
+void _fox_file_free(struct foxptr *p)
+{
+    struct _file_header *h = _header(p);
+    int fd = h->fd;
+
+    munmap(h, FILE_DATA + p->allocated);
+    close(fd);
+}
+
+/*
+ * Large blocks get an anonymous mapping of their own, rounded up to whole
+ * pages. data is aligned by starting the header offset bytes into the
+ * mapping, offset is kept in the tag value as for aligned heap blocks.
+ */
+static usize _page_size()
+{
+    static usize page = 0;
+
+    if (page == 0)
+        page = sysconf(_SC_PAGESIZE);
+
+    return page;
+}
+
+static usize _mmap_len(usize offset, usize size, usize extra)
+{
+    usize page = _page_size();
+    usize len = offset + FOX_HDR_SIZE + size + extra;
+
+    if (len < size || len > SIZE_MAX - page)
+        return 0;
+
+    return (len + page - 1) & ~(page - 1);
+}
+
+struct foxptr *_fox_mmap_alloc(usize size, usize extra, usize shift,
+    bool huge)
+{
+    usize align = shift ? (usize) 1 << shift : FOX_ALIGN;
+    usize offset = ((FOX_HDR_SIZE + align - 1) & ~(align - 1)) - FOX_HDR_SIZE;
+    usize len = _mmap_len(offset, size, extra);
+
+    if (len == 0)
+        return NULL;
+
+    u8 *base = mmap(NULL, len, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+
+#ifdef MADV_HUGEPAGE
+    /* only advice, the kernel may have huge pages turned off */
+    if (huge)
+        madvise(base, len, MADV_HUGEPAGE);
+#else
+    (void) huge;
+#endif
+
+    struct foxptr *p = (void*) (base + offset + sizeof(usize));
+    fox_tag(p) = fox_tag_make(FOX_MMAP, offset) | fox_tag_align_make(shift);
+    p->allocated = size;
+
+    return p;
+}
+
+/*
+ * The pages are moved rather than copied, and the huge page advice goes
+ * with them. Without mremap the block is copied into a new mapping.
+ */
+struct foxptr *_fox_mmap_realloc(struct foxptr *p, usize new_size,
+    usize extra)
+{
+    usize tag = fox_tag(p), offset = fox_tag_value(tag);
+    usize old_len = _mmap_len(offset, p->allocated, extra);
+    usize new_len = _mmap_len(offset, new_size, extra);
+    u8 *old = (u8*) fox_base(p) - offset;
+
+    if (new_len == 0)
+        return NULL;
+
+    if (new_len == old_len) {
+        p->allocated = new_size;
+        return p;
+    }
+
+#ifdef MREMAP_MAYMOVE
+    u8 *base = mremap(old, old_len, new_len, MREMAP_MAYMOVE);
+    if (base == MAP_FAILED)
+        return NULL;
+#else
+    u8 *base = mmap(NULL, new_len, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+    memcpy(base, old, old_len < new_len ? old_len : new_len);
+    munmap(old, old_len);
+#endif
+
+    struct foxptr *next = (void*) (base + offset + sizeof(usize));
+    next->allocated = new_size;
+
+    return next;
+}
+
+void _fox_mmap_free(struct foxptr *p, usize extra)
+{
+    usize offset = fox_tag_value(fox_tag(p));
+
+    munmap((u8*) fox_base(p) - offset, _mmap_len(offset, p->allocated, extra));
+}
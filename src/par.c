@@ -0,0 +1,409 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <num.h>
+#include <alloc.h>
+#include <par.h>
+#include <pool.h>
+#include <utils.h>
+#include <vec.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PAR_CHUNK   (64 * 1024) /* bytes per chunk, about */
+#define PAR_LINE    64
+#define PAR_POLL    1024        /* items between checks for cancellation */
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct fox_pool *shared = NULL;
+static usize wanted = 0;
+
+static void  _run(void (*run)(void *ctx, usize task), void *ctx, usize tasks);
+static usize _chunk_items(usize chunksize, usize bytes);
+
+void fox_par_threads(const usize threads)
+{
+    pthread_mutex_lock(&lock);
+    fox_pool_del(shared);
+    shared = NULL;
+    wanted = threads;
+    pthread_mutex_unlock(&lock);
+}
+
+usize fox_par_thread_count(void)
+{
+    if (wanted != 0)
+        return wanted;
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (usize) online : 1;
+}
+
+/* chunks of the vector, the last one may be short */
+struct _chunks {
+    u8 *items;
+    usize size;
+    usize chunksize;
+    usize per;
+    usize count;
+};
+
+static struct _chunks _split(const struct fox_vec *vec, usize bytes)
+{
+    struct _chunks c = { vec->items, vec->size, vec->chunksize, 0, 0 };
+
+    c.per = _chunk_items(vec->chunksize, bytes);
+    c.count = (vec->size + c.per - 1) / c.per;
+
+    return c;
+}
+
+static inline usize _chunk_len(const struct _chunks *c, usize chunk)
+{
+    usize start = chunk * c->per;
+    return c->size - start < c->per ? c->size - start : c->per;
+}
+
+struct _for_each {
+    struct _chunks chunks;
+    visitor *visit;
+    void *ctx;
+};
+
+static void _for_each_chunk(void *ctx, usize chunk)
+{
+    struct _for_each *f = ctx;
+    u8 *item = f->chunks.items + chunk * f->chunks.per * f->chunks.chunksize;
+
+    for (usize i = _chunk_len(&f->chunks, chunk); i > 0; i--) {
+        f->visit(item, f->ctx);
+        item += f->chunks.chunksize;
+    }
+}
+
+void fox_vec_par_for_each(struct fox_vec *vec, visitor *visit, void *ctx)
+{
+    assert(vec != NULL);
+    assert(visit != NULL);
+
+    struct _for_each f = { _split(vec, PAR_CHUNK), visit, ctx };
+
+    _run(_for_each_chunk, &f, f.chunks.count);
+}
+
+struct _reduce {
+    struct _chunks chunks;
+    u8 *partials;
+    const void *identity;
+    usize size;
+    folder *fold;
+};
+
+static void _reduce_chunk(void *ctx, usize chunk)
+{
+    struct _reduce *r = ctx;
+    u8 *acc = r->partials + chunk * r->size;
+    const u8 *item = r->chunks.items +
+        chunk * r->chunks.per * r->chunks.chunksize;
+
+    memcpy(acc, r->identity, r->size);
+
+    for (usize i = _chunk_len(&r->chunks, chunk); i > 0; i--) {
+        r->fold(acc, item);
+        item += r->chunks.chunksize;
+    }
+}
+
+void fox_vec_par_reduce(const struct fox_vec *vec, void *result,
+    const usize size, folder *fold, folder *merge)
+{
+    assert(vec != NULL && result != NULL);
+    assert(fold != NULL && merge != NULL);
+
+    struct _reduce r = { _split(vec, PAR_CHUNK), NULL, result, size, fold };
+
+    if (r.chunks.count > 1)
+        r.partials = fox_reallocarray(NULL, r.chunks.count + 1, size);
+
+    /* one chunk or no memory for the partials, fold in place */
+    if (r.partials == NULL) {
+        const u8 *item = vec->items;
+
+        for (usize i = 0; i < vec->size; i++) {
+            fold(result, item);
+            item += vec->chunksize;
+        }
+
+        return;
+    }
+
+    /* the identity is kept aside, result is merged into as we go */
+    u8 *identity = r.partials + r.chunks.count * size;
+    memcpy(identity, result, size);
+    r.identity = identity;
+
+    _run(_reduce_chunk, &r, r.chunks.count);
+
+    for (usize i = 0; i < r.chunks.count; i++)
+        merge(result, r.partials + i * size);
+
+    fox_free(r.partials);
+}
+
+struct _find {
+    struct _chunks chunks;
+    const void *needle;
+    comparar *comparar;
+    usize found;    /* lowest index found so far, size when none */
+};
+
+static void _found(struct _find *f, usize index)
+{
+    usize seen = __atomic_load_n(&f->found, __ATOMIC_RELAXED);
+
+    while (index < seen && !__atomic_compare_exchange_n(&f->found, &seen,
+        index, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+static void _find_chunk(void *ctx, usize chunk)
+{
+    struct _find *f = ctx;
+    usize start = chunk * f->chunks.per, len = _chunk_len(&f->chunks, chunk);
+    const u8 *items = f->chunks.items + start * f->chunks.chunksize;
+
+    if (__atomic_load_n(&f->found, __ATOMIC_RELAXED) < start)
+        return;
+
+    if (f->comparar == NULL) {
+        isize i = fox_memfind(items, len, f->chunks.chunksize, f->needle);
+        if (i >= 0)
+            _found(f, start + i);
+        return;
+    }
+
+    for (usize i = 0; i < len; i++) {
+        if (i % PAR_POLL == 0 &&
+            __atomic_load_n(&f->found, __ATOMIC_RELAXED) < start)
+            return;
+
+        if (f->comparar(items + i * f->chunks.chunksize, f->needle)) {
+            _found(f, start + i);
+            return;
+        }
+    }
+}
+
+isize fox_vec_par_find(const struct fox_vec *vec, const void *needle,
+    comparar *comparar)
+{
+    assert(vec != NULL);
+
+    struct _find f = { _split(vec, PAR_CHUNK), needle, comparar, vec->size };
+
+    _run(_find_chunk, &f, f.chunks.count);
+
+    return f.found < vec->size ? (isize) f.found : -1;
+}
+
+/*
+ * Runs of about size / threads items are sorted with fox_vec_stable_sort,
+ * then merged in pairs level by level between the items and a scratch
+ * buffer. Every merge is cut into parts at equal distances of its output,
+ * found by a binary search on both runs, so the last levels with only a
+ * couple of merges still keep every thread busy.
+ */
+struct _sort {
+    struct _chunks runs;
+    comparar *comparar;
+    const u8 *src;
+    u8 *dest;
+    usize width;    /* items per run at this level */
+    usize parts;    /* pieces each merge is cut into */
+};
+
+static inline bool _less(const struct _sort *s, const u8 *a, const u8 *b)
+{
+    if (s->comparar != NULL)
+        return !s->comparar(b, a);
+
+    return fox_memcompare(a, b, s->runs.chunksize) < 0;
+}
+
+static void _sort_run(void *ctx, usize run)
+{
+    struct _sort *s = ctx;
+    struct fox_vec view = { s->runs.chunksize, _chunk_len(&s->runs, run),
+        s->runs.items + run * s->runs.per * s->runs.chunksize };
+
+    fox_vec_stable_sort(&view, s->comparar);
+}
+
+/* how many items of a come before the first k items of the merge */
+static usize _corank(const struct _sort *s, usize k, const u8 *a, usize na,
+    const u8 *b, usize nb)
+{
+    usize size = s->runs.chunksize;
+    usize lo = k > nb ? k - nb : 0, hi = k < na ? k : na;
+
+    while (lo < hi) {
+        usize i = lo + (hi - lo) / 2, j = k - i;
+
+        /* a[i] still goes before b[j - 1], take more of a */
+        if (!_less(s, b + (j - 1) * size, a + i * size))
+            lo = i + 1;
+        else
+            hi = i;
+    }
+
+    return lo;
+}
+
+static void _merge_part(void *ctx, usize task)
+{
+    struct _sort *s = ctx;
+    usize size = s->runs.chunksize, n = s->runs.size;
+    usize first = task / s->parts * 2 * s->width, part = task % s->parts;
+    usize na = n - first < s->width ? n - first : s->width;
+    usize nb = n - first - na < s->width ? n - first - na : s->width;
+    usize total = na + nb;
+    usize from = total * part / s->parts, to = total * (part + 1) / s->parts;
+
+    const u8 *a = s->src + first * size, *b = a + na * size;
+    usize i = _corank(s, from, a, na, b, nb), j = from - i;
+    usize ie = _corank(s, to, a, na, b, nb), je = to - ie;
+    u8 *out = s->dest + (first + from) * size;
+
+    while (i < ie && j < je) {
+        if (_less(s, b + j * size, a + i * size))
+            memcpy(out, b + j++ * size, size);
+        else
+            memcpy(out, a + i++ * size, size);
+        out += size;
+    }
+
+    fox_memcopy(out, a + i * size, (ie - i) * size);
+    out += (ie - i) * size;
+    fox_memcopy(out, b + j * size, (je - j) * size);
+}
+
+void fox_vec_par_sort(struct fox_vec *vec, comparar *comparar)
+{
+    assert(vec != NULL);
+
+    usize threads = fox_par_thread_count(), size = vec->chunksize;
+    usize per = (vec->size + threads - 1) / threads;
+    struct _sort s = { _split(vec, per * size), comparar, NULL, NULL, 0, 1 };
+    u8 *tmp = NULL;
+
+    if (s.runs.count > 1)
+        tmp = fox_reallocarray(NULL, vec->size, size);
+
+    if (tmp == NULL) {
+        fox_vec_stable_sort(vec, comparar);
+        return;
+    }
+
+    _run(_sort_run, &s, s.runs.count);
+
+    s.src = vec->items;
+    s.dest = tmp;
+
+    for (s.width = s.runs.per; s.width < vec->size; s.width *= 2) {
+        usize merges = (vec->size + 2 * s.width - 1) / (2 * s.width);
+
+        s.parts = merges < threads ? (threads + merges - 1) / merges : 1;
+        _run(_merge_part, &s, merges * s.parts);
+
+        const u8 *src = s.src;
+        s.src = s.dest;
+        s.dest = (u8*) src;
+    }
+
+    if (s.src != vec->items)
+        fox_memcopy(vec->items, s.src, vec->size * size);
+
+    fox_free(tmp);
+}
+
+/* whole cache lines worth of items, close to bytes */
+static usize _chunk_items(usize chunksize, usize bytes)
+{
+    usize a = chunksize, b = PAR_LINE;
+
+    while (b != 0) {
+        usize t = a % b;
+        a = b;
+        b = t;
+    }
+
+    usize line = PAR_LINE / a;
+    usize per = bytes / chunksize;
+
+    per = (per + line - 1) / line * line;
+    return per ? per : line;
+}
+
+/* the calling thread makes up the last one, it steals while it waits */
+static struct fox_pool *_pool(void)
+{
+    struct fox_pool *pool = __atomic_load_n(&shared, __ATOMIC_ACQUIRE);
+
+    if (pool != NULL)
+        return pool;
+
+    pthread_mutex_lock(&lock);
+    if (shared == NULL)
+        __atomic_store_n(&shared, fox_pool_new(fox_par_thread_count() - 1),
+            __ATOMIC_RELEASE);
+    pool = shared;
+    pthread_mutex_unlock(&lock);
+
+    return pool;
+}
+
+/* tasks lo to hi, halved until one is left, the upper half is spawned */
+struct _range {
+    struct fox_pool *pool;
+    void (*run)(void *ctx, usize task);
+    void *ctx;
+    usize lo;
+    usize hi;
+};
+
+static void _range(void *arg)
+{
+    struct _range *r = arg;
+
+    if (r->hi - r->lo == 1) {
+        r->run(r->ctx, r->lo);
+        return;
+    }
+
+    usize mid = r->lo + (r->hi - r->lo) / 2;
+    struct _range lower = { r->pool, r->run, r->ctx, r->lo, mid };
+    struct _range upper = { r->pool, r->run, r->ctx, mid, r->hi };
+    struct fox_task *task = fox_pool_spawn(r->pool, _range, &upper);
+
+    _range(&lower);
+    fox_pool_wait(r->pool, task);
+}
+
+static void _run(void (*run)(void *ctx, usize task), void *ctx, usize tasks)
+{
+    struct _range r = { NULL, run, ctx, 0, tasks };
+
+    if (tasks > 1 && fox_par_thread_count() > 1)
+        r.pool = _pool();
+
+    /* too small to share or no pool, stay on this thread */
+    if (r.pool == NULL) {
+        for (usize i = 0; i < tasks; i++)
+            run(ctx, i);
+        return;
+    }
+
+    _range(&r);
+}
@@ -0,0 +1,480 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <num.h>
+#include <alloc.h>
+#include <pool.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define POOL_DEQUE  256     /* initial deque capacity, a power of two */
+#define POOL_CACHE  256     /* finished tasks a worker keeps for reuse */
+#define POOL_SPINS  64      /* empty rounds before a thread goes to sleep */
+
+struct fox_task {
+    runnable *run;
+    void *ctx;
+    struct fox_task *next;  /* injected stack or free list */
+    bool done;
+};
+
+/*
+ * Chase-Lev deque with the memory orders of Le, Pop, Cohen and Zappa
+ * Nardelli, "Correct and efficient work-stealing for weak memory models".
+ * A full array is replaced by one twice as large, the old one is kept until
+ * the pool goes away since a thief may still be reading from it.
+ */
+struct _array {
+    struct _array *prev;
+    isize size;
+    struct fox_task *tasks[];
+};
+
+struct _worker {
+    isize top;
+    char pad[64 - sizeof(isize)];
+    isize bottom;
+    struct _array *array;
+    struct fox_pool *pool;
+    struct fox_task *cache;
+    usize cached;
+    u32 seed;
+    pthread_t thread;
+} __attribute__((aligned(64)));
+
+struct fox_pool {
+    struct _worker *workers;
+    usize count;
+    usize started;
+    struct fox_task *injected;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t finished;
+    usize sleepers;     /* workers waiting for work */
+    usize waiters;      /* threads waiting for a task to finish */
+    bool stopping;
+};
+
+static __thread struct _worker *self = NULL;
+
+static void *_worker_main(void *arg);
+
+static struct _array *_array_new(isize size, struct _array *prev)
+{
+    struct _array *a = fox_alloc(sizeof(*a) + size * sizeof(*a->tasks));
+
+    if (a != NULL) {
+        a->prev = prev;
+        a->size = size;
+    }
+
+    return a;
+}
+
+static inline struct fox_task *_slot(struct _array *a, isize i)
+{
+    return __atomic_load_n(a->tasks + (i & (a->size - 1)), __ATOMIC_RELAXED);
+}
+
+static inline void _set_slot(struct _array *a, isize i, struct fox_task *t)
+{
+    __atomic_store_n(a->tasks + (i & (a->size - 1)), t, __ATOMIC_RELAXED);
+}
+
+/* only called by the owner, false when the deque is full and cannot grow */
+static bool _push(struct _worker *w, struct fox_task *task)
+{
+    isize b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED);
+    isize t = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+    struct _array *a = __atomic_load_n(&w->array, __ATOMIC_RELAXED);
+
+    if (b - t > a->size - 1) {
+        struct _array *bigger = _array_new(a->size * 2, a);
+        if (bigger == NULL)
+            return false;
+
+        for (isize i = t; i < b; i++)
+            _set_slot(bigger, i, _slot(a, i));
+
+        __atomic_store_n(&w->array, bigger, __ATOMIC_RELEASE);
+        a = bigger;
+    }
+
+    _set_slot(a, b, task);
+    __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+/* only called by the owner, newest task first */
+static struct fox_task *_take(struct _worker *w)
+{
+    isize b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED) - 1;
+    struct _array *a = __atomic_load_n(&w->array, __ATOMIC_RELAXED);
+    struct fox_task *task = NULL;
+
+    __atomic_store_n(&w->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    isize t = __atomic_load_n(&w->top, __ATOMIC_RELAXED);
+
+    if (t <= b) {
+        task = _slot(a, b);
+
+        /* the last one, race the thieves for it */
+        if (t == b) {
+            if (!__atomic_compare_exchange_n(&w->top, &t, t + 1, false,
+                __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                task = NULL;
+            __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+
+    return task;
+}
+
+/* any thread, oldest task first, NULL when empty or lost to another thief */
+static struct fox_task *_steal(struct _worker *w)
+{
+    isize t = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    isize b = __atomic_load_n(&w->bottom, __ATOMIC_ACQUIRE);
+
+    if (t >= b)
+        return NULL;
+
+    struct _array *a = __atomic_load_n(&w->array, __ATOMIC_ACQUIRE);
+    struct fox_task *task = _slot(a, t);
+
+    if (!__atomic_compare_exchange_n(&w->top, &t, t + 1, false,
+        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return NULL;
+
+    return task;
+}
+
+/* new work, for idle workers and for those waiting on a task as well */
+static void _wake_workers(struct fox_pool *pool)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_RELAXED) == 0 &&
+        __atomic_load_n(&pool->waiters, __ATOMIC_RELAXED) == 0)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->work);
+    pthread_cond_broadcast(&pool->finished);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void _inject(struct fox_pool *pool, struct fox_task *task)
+{
+    task->next = __atomic_load_n(&pool->injected, __ATOMIC_RELAXED);
+
+    while (!__atomic_compare_exchange_n(&pool->injected, &task->next, task,
+        true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+}
+
+/*
+ * The next task for w: its own newest, else the injected ones moved into its
+ * deque, else one stolen from a worker picked at random. Threads outside the
+ * pool pass NULL and only steal.
+ */
+static struct fox_task *_find(struct fox_pool *pool, struct _worker *w)
+{
+    struct fox_task *task;
+    u32 start = 0;
+
+    if (w != NULL) {
+        if ((task = _take(w)) != NULL)
+            return task;
+
+        if (__atomic_load_n(&pool->injected, __ATOMIC_RELAXED) != NULL) {
+            task = __atomic_exchange_n(&pool->injected, NULL,
+                __ATOMIC_ACQUIRE);
+
+            /* keep one, run the rest locally or give them back */
+            while (task != NULL && task->next != NULL) {
+                struct fox_task *next = task->next;
+                if (!_push(w, task))
+                    _inject(pool, task);
+                task = next;
+            }
+
+            if (task != NULL) {
+                _wake_workers(pool);
+                return task;
+            }
+        }
+
+        w->seed ^= w->seed << 13;
+        w->seed ^= w->seed >> 17;
+        w->seed ^= w->seed << 5;
+        start = w->seed;
+    }
+
+    usize started = __atomic_load_n(&pool->started, __ATOMIC_ACQUIRE);
+
+    for (usize i = 0; i < started; i++) {
+        struct _worker *victim = pool->workers + (start + i) % started;
+
+        if (victim != w && (task = _steal(victim)) != NULL)
+            return task;
+    }
+
+    return NULL;
+}
+
+static bool _has_work(struct fox_pool *pool)
+{
+    if (__atomic_load_n(&pool->injected, __ATOMIC_RELAXED) != NULL)
+        return true;
+
+    usize started = __atomic_load_n(&pool->started, __ATOMIC_ACQUIRE);
+
+    for (usize i = 0; i < started; i++) {
+        struct _worker *w = pool->workers + i;
+
+        if (__atomic_load_n(&w->top, __ATOMIC_RELAXED) <
+            __atomic_load_n(&w->bottom, __ATOMIC_RELAXED))
+            return true;
+    }
+
+    return false;
+}
+
+static void _execute(struct fox_pool *pool, struct fox_task *task)
+{
+    task->run(task->ctx);
+
+    __atomic_store_n(&task->done, true, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->waiters, __ATOMIC_SEQ_CST) == 0)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->finished);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+struct fox_pool *fox_pool_new(const usize threads)
+{
+    struct fox_pool *pool = fox_alloc(sizeof(*pool));
+    usize count = threads;
+
+    if (pool == NULL)
+        return NULL;
+
+    if (count == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        count = online > 0 ? (usize) online : 1;
+    }
+
+    pool->workers = fox_alloc_aligned(count * sizeof(*pool->workers), 64);
+    pool->count = count;
+    pool->started = 0;
+    pool->injected = NULL;
+    pool->sleepers = 0;
+    pool->waiters = 0;
+    pool->stopping = false;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->finished, NULL);
+
+    if (pool->workers == NULL) {
+        fox_pool_del(pool);
+        return NULL;
+    }
+
+    for (usize i = 0; i < count; i++) {
+        struct _worker *w = pool->workers + i;
+
+        w->top = w->bottom = 0;
+        w->array = _array_new(POOL_DEQUE, NULL);
+        w->pool = pool;
+        w->cache = NULL;
+        w->cached = 0;
+        w->seed = 2463534242u + i * 2654435761u;
+
+        if (w->array == NULL)
+            break;
+    }
+
+    /* workers are only counted once all of them are set up */
+    for (usize i = 0; i < count && pool->workers[i].array != NULL; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, _worker_main,
+            pool->workers + i) != 0)
+            break;
+        __atomic_store_n(&pool->started, i + 1, __ATOMIC_RELEASE);
+    }
+
+    if (pool->started == 0) {
+        fox_pool_del(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void fox_pool_del(struct fox_pool *pool)
+{
+    if (pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (usize i = 0; i < pool->started; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+
+    for (usize i = 0; pool->workers != NULL && i < pool->count; i++) {
+        struct _worker *w = pool->workers + i;
+
+        if (w->array == NULL)
+            break;
+
+        while (w->array != NULL) {
+            struct _array *prev = w->array->prev;
+            fox_free(w->array);
+            w->array = prev;
+        }
+
+        while (w->cache != NULL) {
+            struct fox_task *next = w->cache->next;
+            fox_free(w->cache);
+            w->cache = next;
+        }
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->finished);
+    fox_free(pool->workers);
+    fox_free(pool);
+}
+
+usize fox_pool_threads(const struct fox_pool *pool)
+{
+    assert(pool != NULL);
+    return pool->started;
+}
+
+struct fox_task *fox_pool_spawn(struct fox_pool *pool, runnable *run,
+    void *ctx)
+{
+    assert(pool != NULL && run != NULL);
+
+    struct _worker *w = self != NULL && self->pool == pool ? self : NULL;
+    struct fox_task *task;
+
+    if (w != NULL && w->cache != NULL) {
+        task = w->cache;
+        w->cache = task->next;
+        w->cached--;
+    } else {
+        task = fox_alloc(sizeof(*task));
+    }
+
+    if (task == NULL) {
+        run(ctx);
+        return NULL;
+    }
+
+    task->run = run;
+    task->ctx = ctx;
+    task->next = NULL;
+    task->done = false;
+
+    if (w == NULL || !_push(w, task))
+        _inject(pool, task);
+
+    _wake_workers(pool);
+
+    return task;
+}
+
+void fox_pool_wait(struct fox_pool *pool, struct fox_task *task)
+{
+    assert(pool != NULL);
+
+    struct _worker *w = self != NULL && self->pool == pool ? self : NULL;
+    usize idle = 0;
+
+    if (task == NULL)
+        return;
+
+    while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) {
+        struct fox_task *other = _find(pool, w);
+
+        if (other != NULL) {
+            _execute(pool, other);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < POOL_SPINS) {
+            sched_yield();
+            continue;
+        }
+
+        /* woken once any task is done or new work shows up */
+        pthread_mutex_lock(&pool->lock);
+        __atomic_fetch_add(&pool->waiters, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n(&task->done, __ATOMIC_SEQ_CST) &&
+            !_has_work(pool))
+            pthread_cond_wait(&pool->finished, &pool->lock);
+        __atomic_fetch_sub(&pool->waiters, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&pool->lock);
+        idle = 0;
+    }
+
+    if (w != NULL && w->cached < POOL_CACHE) {
+        task->next = w->cache;
+        w->cache = task;
+        w->cached++;
+    } else {
+        fox_free(task);
+    }
+}
+
+static void *_worker_main(void *arg)
+{
+    struct _worker *w = arg;
+    struct fox_pool *pool = w->pool;
+    usize idle = 0;
+
+    self = w;
+
+    for (;;) {
+        struct fox_task *task = _find(pool, w);
+
+        if (task != NULL) {
+            _execute(pool, task);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < POOL_SPINS) {
+            sched_yield();
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        __atomic_fetch_add(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        if (!pool->stopping && !_has_work(pool))
+            pthread_cond_wait(&pool->work, &pool->lock);
+        __atomic_fetch_sub(&pool->sleepers, 1, __ATOMIC_RELAXED);
+
+        bool stopping = pool->stopping;
+        pthread_mutex_unlock(&pool->lock);
+        idle = 0;
+
+        if (stopping)
+            return NULL;
+    }
+}
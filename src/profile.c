@@ -0,0 +1,267 @@
+#include <num.h>
+#include <alloc.h>
+
+#include <execinfo.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc_private.h"
+
+#define PROFILE_DEPTH   32
+#define PROFILE_SKIP    2   /* _fox_profile_alloc and its caller */
+#define SITE_BUCKETS    1024
+#define SAMPLE_BUCKETS  4096
+
+/*
+ * Sampling heap profiler. Every thread counts down the bytes it allocates
+ * and records the allocation that crosses zero, then restarts the countdown
+ * at a random point of [1, 2 * interval], so on average one sample is taken
+ * every interval bytes. Sampled blocks carry FOX_TAG_SAMPLED, which keeps
+ * the free path of unsampled blocks down to a bit test.
+ */
+struct _site {
+    struct _site *next;
+    u64 hash;
+    usize depth;
+    void *stack[PROFILE_DEPTH];
+    usize live_count, live_bytes;
+    usize total_count, total_bytes;
+};
+
+struct _sample {
+    struct _sample *next;
+    void *ptr;
+    struct _site *site;
+    usize count, bytes;
+};
+
+static usize interval = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct _site *sites[SITE_BUCKETS];
+static struct _sample *samples[SAMPLE_BUCKETS];
+
+static __thread i64 countdown = 0;
+static __thread u64 seed = 0;
+
+static usize            _next_interval();
+static struct _site    *_site_get(void **stack, usize depth);
+static usize            _sample_bucket(const void *ptr);
+static void             _profile_exit();
+
+void _fox_profile_init(usize bytes)
+{
+    interval = bytes;
+    atexit(_profile_exit);
+}
+
+void _fox_profile_alloc(struct foxptr *ptr)
+{
+    /* the first allocation of a thread starts its countdown */
+    if (seed == 0)
+        countdown = _next_interval();
+
+    if ((countdown -= ptr->allocated) > 0)
+        return;
+
+    countdown = _next_interval();
+
+    void *stack[PROFILE_DEPTH + PROFILE_SKIP];
+    int depth = backtrace(stack, PROFILE_DEPTH + PROFILE_SKIP);
+    usize skip = depth > PROFILE_SKIP ? PROFILE_SKIP : 0;
+
+    struct _sample *sample = malloc(sizeof(*sample));
+    if (sample == NULL)
+        return;
+
+    /* every sample stands for about interval bytes */
+    sample->ptr = ptr;
+    sample->count = ptr->allocated >= interval || ptr->allocated == 0 ? 1 :
+        interval / ptr->allocated;
+    sample->bytes = sample->count * (ptr->allocated ? ptr->allocated : 1);
+
+    pthread_mutex_lock(&lock);
+
+    struct _site *site = _site_get(stack + skip, depth - skip);
+    if (site == NULL) {
+        pthread_mutex_unlock(&lock);
+        free(sample);
+        return;
+    }
+
+    site->live_count += sample->count;
+    site->live_bytes += sample->bytes;
+    site->total_count += sample->count;
+    site->total_bytes += sample->bytes;
+    sample->site = site;
+
+    usize b = _sample_bucket(ptr);
+    sample->next = samples[b];
+    samples[b] = sample;
+
+    pthread_mutex_unlock(&lock);
+
+    fox_tag(ptr) |= FOX_TAG_SAMPLED;
+}
+
+void *_fox_profile_detach(struct foxptr *ptr)
+{
+    fox_tag(ptr) &= ~(usize) FOX_TAG_SAMPLED;
+
+    pthread_mutex_lock(&lock);
+
+    struct _sample **it = samples + _sample_bucket(ptr);
+    while (*it != NULL && (*it)->ptr != ptr)
+        it = &(*it)->next;
+
+    struct _sample *sample = *it;
+    if (sample != NULL) {
+        *it = sample->next;
+        sample->site->live_count -= sample->count;
+        sample->site->live_bytes -= sample->bytes;
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return sample;
+}
+
+void _fox_profile_reattach(struct foxptr *ptr, void *sample)
+{
+    struct _sample *s = sample;
+
+    if (s == NULL)
+        return;
+
+    pthread_mutex_lock(&lock);
+
+    s->site->live_count += s->count;
+    s->site->live_bytes += s->bytes;
+
+    usize b = _sample_bucket(ptr);
+    s->next = samples[b];
+    samples[b] = s;
+
+    pthread_mutex_unlock(&lock);
+
+    fox_tag(ptr) |= FOX_TAG_SAMPLED;
+}
+
+void _fox_profile_drop(void *sample)
+{
+    free(sample);
+}
+
+void _fox_profile_free(struct foxptr *ptr)
+{
+    free(_fox_profile_detach(ptr));
+}
+
+bool fox_alloc_profile(const char *path)
+{
+    FILE *out = fopen(path, "w");
+    if (out == NULL)
+        return false;
+
+    usize live_count = 0, live_bytes = 0, total_count = 0, total_bytes = 0;
+
+    pthread_mutex_lock(&lock);
+
+    for (usize i = 0; i < SITE_BUCKETS; i++) {
+        for (struct _site *s = sites[i]; s != NULL; s = s->next) {
+            live_count += s->live_count;
+            live_bytes += s->live_bytes;
+            total_count += s->total_count;
+            total_bytes += s->total_bytes;
+        }
+    }
+
+    /* same text layout as gperftools, so pprof can read it */
+    fprintf(out, "heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu\n",
+        live_count, live_bytes, total_count, total_bytes, interval);
+
+    for (usize i = 0; i < SITE_BUCKETS; i++) {
+        for (struct _site *s = sites[i]; s != NULL; s = s->next) {
+            fprintf(out, "%zu: %zu [%zu: %zu] @", s->live_count,
+                s->live_bytes, s->total_count, s->total_bytes);
+
+            for (usize j = 0; j < s->depth; j++)
+                fprintf(out, " %p", s->stack[j]);
+
+            fputc('\n', out);
+        }
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    FILE *maps = fopen("/proc/self/maps", "r");
+    if (maps != NULL) {
+        char buffer[4096];
+        usize n;
+
+        fputs("\nMAPPED_LIBRARIES:\n", out);
+        while ((n = fread(buffer, 1, sizeof(buffer), maps)) > 0)
+            fwrite(buffer, 1, n, out);
+
+        fclose(maps);
+    }
+
+    return fclose(out) == 0;
+}
+
+static usize _next_interval()
+{
+    if (seed == 0)
+        seed = (u64) (uintptr_t) &seed ^ 0x9e3779b97f4a7c15ULL;
+
+    /* P0, every allocation is sampled */
+    if (interval == 0)
+        return 0;
+
+    /* xorshift64 */
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+
+    return 1 + seed % (2 * interval);
+}
+
+static struct _site *_site_get(void **stack, usize depth)
+{
+    u64 hash = 0xcbf29ce484222325ULL;
+
+    for (usize i = 0; i < depth; i++) {
+        hash ^= (u64) (uintptr_t) stack[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    struct _site **bucket = sites + (hash & (SITE_BUCKETS - 1));
+
+    for (struct _site *s = *bucket; s != NULL; s = s->next)
+        if (s->hash == hash && s->depth == depth &&
+            memcmp(s->stack, stack, depth * sizeof(void*)) == 0)
+            return s;
+
+    struct _site *site = calloc(1, sizeof(*site));
+    if (site == NULL)
+        return NULL;
+
+    site->hash = hash;
+    site->depth = depth;
+    memcpy(site->stack, stack, depth * sizeof(void*));
+    site->next = *bucket;
+    *bucket = site;
+
+    return site;
+}
+
+static usize _sample_bucket(const void *ptr)
+{
+    return ((uintptr_t) ptr >> 4) * 0x9e3779b97f4a7c15ULL >> 52;
+}
+
+static void _profile_exit()
+{
+    fox_alloc_profile("heapprof.foxstd");
+}
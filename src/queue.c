@@ -0,0 +1,509 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <num.h>
+#include <alloc.h>
+#include <utils.h>
+#include <queue.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#define QUEUE_MIN   2
+#define QUEUE_SPINS 64      /* failed tries before a thread goes to sleep */
+
+/* threads sleeping until the other side has made progress */
+struct _sleepers {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    usize count;
+};
+
+/* an index owned by one side, with what it last saw of the other one */
+struct _side {
+    usize index;
+    usize cached;
+} __attribute__((aligned(64)));
+
+struct fox_spsc {
+    struct _side head;      /* consumer */
+    struct _side tail;      /* producer */
+    usize chunksize;
+    usize capacity;
+    u8 *items;
+    struct _sleepers readers;
+    struct _sleepers writers;
+};
+
+struct _index {
+    usize index;
+} __attribute__((aligned(64)));
+
+/*
+ * Slot i is free for the producer of position p when its sequence is p,
+ * and holds an item for the consumer of position p when it is p + 1. The
+ * consumer then sets it to p + capacity, for the next round of producers.
+ */
+struct fox_mpmc {
+    struct _index head;
+    struct _index tail;
+    usize chunksize;
+    usize capacity;
+    usize stride;           /* sequence number, then the item */
+    u8 *slots;
+    struct _sleepers readers;
+    struct _sleepers writers;
+};
+
+static usize _round_capacity(usize capacity)
+{
+    usize cap = QUEUE_MIN;
+
+    while (cap < capacity) {
+        if (cap * 2 < cap)
+            return 0;
+        cap *= 2;
+    }
+
+    return cap;
+}
+
+static void _sleepers_init(struct _sleepers *s)
+{
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->count = 0;
+}
+
+static void _sleepers_destroy(struct _sleepers *s)
+{
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->cond);
+}
+
+/* after publishing progress, the fence orders it before reading count */
+static void _wake(struct _sleepers *s)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s->count, __ATOMIC_RELAXED) == 0)
+        return;
+
+    pthread_mutex_lock(&s->lock);
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/*
+ * Yields for the first QUEUE_SPINS rounds, then sleeps unless ready tells
+ * the queue has changed since. Whoever changes it next sees count and
+ * wakes us.
+ */
+static void _wait(struct _sleepers *s, u32 *idle, bool (*ready)(void *q),
+    void *q)
+{
+    if (++*idle < QUEUE_SPINS) {
+        sched_yield();
+        return;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    __atomic_fetch_add(&s->count, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!ready(q))
+        pthread_cond_wait(&s->cond, &s->lock);
+    __atomic_fetch_sub(&s->count, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&s->lock);
+    *idle = 0;
+}
+
+/* copies count items between a ring and a flat buffer, in two pieces */
+static void _ring_in(u8 *ring, usize capacity, usize chunksize, usize pos,
+    const u8 *data, usize count)
+{
+    usize at = pos & (capacity - 1), first = capacity - at;
+
+    if (first > count)
+        first = count;
+
+    fox_memcopy(ring + at * chunksize, data, first * chunksize);
+    fox_memcopy(ring, data + first * chunksize, (count - first) * chunksize);
+}
+
+static void _ring_out(const u8 *ring, usize capacity, usize chunksize,
+    usize pos, u8 *out, usize count)
+{
+    usize at = pos & (capacity - 1), first = capacity - at;
+
+    if (first > count)
+        first = count;
+
+    fox_memcopy(out, ring + at * chunksize, first * chunksize);
+    fox_memcopy(out + first * chunksize, ring, (count - first) * chunksize);
+}
+
+struct fox_spsc *fox_spsc_new(const usize chunksize, const usize capacity)
+{
+    assert(chunksize > 0);
+
+    usize cap = _round_capacity(capacity);
+    struct fox_spsc *q = fox_alloc_aligned(sizeof(*q), 64);
+
+    if (q == NULL)
+        return NULL;
+
+    q->items = cap ? fox_reallocarray(NULL, cap, chunksize) : NULL;
+    if (q->items == NULL) {
+        fox_free(q);
+        return NULL;
+    }
+
+    q->head.index = q->head.cached = 0;
+    q->tail.index = q->tail.cached = 0;
+    q->chunksize = chunksize;
+    q->capacity = cap;
+    _sleepers_init(&q->readers);
+    _sleepers_init(&q->writers);
+
+    return q;
+}
+
+void fox_spsc_del(struct fox_spsc *q, deletor *deletor)
+{
+    assert(q != NULL);
+
+    for (usize i = q->head.index; deletor != NULL && i != q->tail.index; i++)
+        deletor(q->items + (i & (q->capacity - 1)) * q->chunksize);
+
+    _sleepers_destroy(&q->readers);
+    _sleepers_destroy(&q->writers);
+    fox_free(q->items);
+    fox_free(q);
+}
+
+usize fox_spsc_capacity(const struct fox_spsc *q)
+{
+    return q->capacity;
+}
+
+usize fox_spsc_try_push_n(struct fox_spsc *q, const void *data,
+    const usize count)
+{
+    assert(q != NULL);
+    assert(data != NULL || count == 0);
+
+    usize tail = q->tail.index;
+    usize room = q->capacity - (tail - q->tail.cached);
+
+    if (room < count) {
+        q->tail.cached = __atomic_load_n(&q->head.index, __ATOMIC_ACQUIRE);
+        room = q->capacity - (tail - q->tail.cached);
+    }
+
+    usize n = room < count ? room : count;
+    if (n == 0)
+        return 0;
+
+    _ring_in(q->items, q->capacity, q->chunksize, tail, data, n);
+    __atomic_store_n(&q->tail.index, tail + n, __ATOMIC_RELEASE);
+    _wake(&q->readers);
+
+    return n;
+}
+
+usize fox_spsc_try_pop_n(struct fox_spsc *q, void *out, const usize count)
+{
+    assert(q != NULL);
+    assert(out != NULL || count == 0);
+
+    usize head = q->head.index;
+    usize ready = q->head.cached - head;
+
+    if (ready < count) {
+        q->head.cached = __atomic_load_n(&q->tail.index, __ATOMIC_ACQUIRE);
+        ready = q->head.cached - head;
+    }
+
+    usize n = ready < count ? ready : count;
+    if (n == 0)
+        return 0;
+
+    _ring_out(q->items, q->capacity, q->chunksize, head, out, n);
+    __atomic_store_n(&q->head.index, head + n, __ATOMIC_RELEASE);
+    _wake(&q->writers);
+
+    return n;
+}
+
+bool fox_spsc_try_push(struct fox_spsc *q, const void *data)
+{
+    return fox_spsc_try_push_n(q, data, 1) == 1;
+}
+
+bool fox_spsc_try_pop(struct fox_spsc *q, void *out)
+{
+    return fox_spsc_try_pop_n(q, out, 1) == 1;
+}
+
+static bool _spsc_has_room(void *arg)
+{
+    struct fox_spsc *q = arg;
+
+    return q->tail.index -
+        __atomic_load_n(&q->head.index, __ATOMIC_ACQUIRE) < q->capacity;
+}
+
+static bool _spsc_has_items(void *arg)
+{
+    struct fox_spsc *q = arg;
+
+    return __atomic_load_n(&q->tail.index, __ATOMIC_ACQUIRE) != q->head.index;
+}
+
+void fox_spsc_push_n(struct fox_spsc *q, const void *data, const usize count)
+{
+    const u8 *iter = data;
+    u32 idle = 0;
+
+    for (usize done = 0; done < count;) {
+        usize n = fox_spsc_try_push_n(q, iter + done * q->chunksize,
+            count - done);
+
+        done += n;
+        if (n == 0)
+            _wait(&q->writers, &idle, _spsc_has_room, q);
+    }
+}
+
+void fox_spsc_pop_n(struct fox_spsc *q, void *out, const usize count)
+{
+    u8 *iter = out;
+    u32 idle = 0;
+
+    for (usize done = 0; done < count;) {
+        usize n = fox_spsc_try_pop_n(q, iter + done * q->chunksize,
+            count - done);
+
+        done += n;
+        if (n == 0)
+            _wait(&q->readers, &idle, _spsc_has_items, q);
+    }
+}
+
+void fox_spsc_push(struct fox_spsc *q, const void *data)
+{
+    fox_spsc_push_n(q, data, 1);
+}
+
+void fox_spsc_pop(struct fox_spsc *q, void *out)
+{
+    fox_spsc_pop_n(q, out, 1);
+}
+
+static inline usize *_seq(const struct fox_mpmc *q, usize pos)
+{
+    return (usize*) (q->slots + (pos & (q->capacity - 1)) * q->stride);
+}
+
+static inline u8 *_item(const struct fox_mpmc *q, usize pos)
+{
+    return (u8*) _seq(q, pos) + sizeof(usize);
+}
+
+struct fox_mpmc *fox_mpmc_new(const usize chunksize, const usize capacity)
+{
+    assert(chunksize > 0);
+
+    usize cap = _round_capacity(capacity);
+    usize stride = (sizeof(usize) + chunksize + sizeof(usize) - 1) /
+        sizeof(usize) * sizeof(usize);
+    struct fox_mpmc *q = fox_alloc_aligned(sizeof(*q), 64);
+
+    if (q == NULL)
+        return NULL;
+
+    q->slots = cap ? fox_reallocarray(NULL, cap, stride) : NULL;
+    if (q->slots == NULL) {
+        fox_free(q);
+        return NULL;
+    }
+
+    q->head.index = q->tail.index = 0;
+    q->chunksize = chunksize;
+    q->capacity = cap;
+    q->stride = stride;
+    for (usize i = 0; i < cap; i++)
+        *_seq(q, i) = i;
+    _sleepers_init(&q->readers);
+    _sleepers_init(&q->writers);
+
+    return q;
+}
+
+void fox_mpmc_del(struct fox_mpmc *q, deletor *deletor)
+{
+    assert(q != NULL);
+
+    for (usize i = q->head.index; deletor != NULL && i != q->tail.index; i++)
+        deletor(_item(q, i));
+
+    _sleepers_destroy(&q->readers);
+    _sleepers_destroy(&q->writers);
+    fox_free(q->slots);
+    fox_free(q);
+}
+
+usize fox_mpmc_capacity(const struct fox_mpmc *q)
+{
+    return q->capacity;
+}
+
+/*
+ * Claims up to count consecutive positions from index whose slots all have
+ * the sequence pos + offset, returns how many with their first in *pos.
+ * A first slot ahead of us means index moved on, one behind means the
+ * queue is full, or empty.
+ */
+static usize _claim(struct fox_mpmc *q, usize *index, usize offset,
+    usize count, usize *pos)
+{
+    usize at = __atomic_load_n(index, __ATOMIC_RELAXED);
+
+    for (;;) {
+        usize n = 0;
+
+        while (n < count) {
+            usize seq = __atomic_load_n(_seq(q, at + n), __ATOMIC_ACQUIRE);
+            isize diff = (isize) (seq - (at + n + offset));
+
+            if (diff == 0) {
+                n++;
+                continue;
+            }
+
+            if (n == 0 && diff > 0) {
+                at = __atomic_load_n(index, __ATOMIC_RELAXED);
+                continue;
+            }
+
+            break;
+        }
+
+        if (n == 0)
+            return 0;
+
+        if (__atomic_compare_exchange_n(index, &at, at + n, true,
+            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            *pos = at;
+            return n;
+        }
+    }
+}
+
+usize fox_mpmc_try_push_n(struct fox_mpmc *q, const void *data,
+    const usize count)
+{
+    assert(q != NULL);
+    assert(data != NULL || count == 0);
+
+    const u8 *iter = data;
+    usize pos, n = _claim(q, &q->tail.index, 0, count, &pos);
+
+    for (usize i = 0; i < n; i++) {
+        memcpy(_item(q, pos + i), iter + i * q->chunksize, q->chunksize);
+        __atomic_store_n(_seq(q, pos + i), pos + i + 1, __ATOMIC_RELEASE);
+    }
+
+    if (n > 0)
+        _wake(&q->readers);
+
+    return n;
+}
+
+usize fox_mpmc_try_pop_n(struct fox_mpmc *q, void *out, const usize count)
+{
+    assert(q != NULL);
+    assert(out != NULL || count == 0);
+
+    u8 *iter = out;
+    usize pos, n = _claim(q, &q->head.index, 1, count, &pos);
+
+    for (usize i = 0; i < n; i++) {
+        memcpy(iter + i * q->chunksize, _item(q, pos + i), q->chunksize);
+        __atomic_store_n(_seq(q, pos + i), pos + i + q->capacity,
+            __ATOMIC_RELEASE);
+    }
+
+    if (n > 0)
+        _wake(&q->writers);
+
+    return n;
+}
+
+bool fox_mpmc_try_push(struct fox_mpmc *q, const void *data)
+{
+    return fox_mpmc_try_push_n(q, data, 1) == 1;
+}
+
+bool fox_mpmc_try_pop(struct fox_mpmc *q, void *out)
+{
+    return fox_mpmc_try_pop_n(q, out, 1) == 1;
+}
+
+static bool _mpmc_has_room(void *arg)
+{
+    struct fox_mpmc *q = arg;
+    usize tail = __atomic_load_n(&q->tail.index, __ATOMIC_RELAXED);
+
+    return (isize) (__atomic_load_n(_seq(q, tail), __ATOMIC_ACQUIRE) -
+        tail) >= 0;
+}
+
+static bool _mpmc_has_items(void *arg)
+{
+    struct fox_mpmc *q = arg;
+    usize head = __atomic_load_n(&q->head.index, __ATOMIC_RELAXED);
+
+    return (isize) (__atomic_load_n(_seq(q, head), __ATOMIC_ACQUIRE) -
+        (head + 1)) >= 0;
+}
+
+void fox_mpmc_push_n(struct fox_mpmc *q, const void *data, const usize count)
+{
+    const u8 *iter = data;
+    u32 idle = 0;
+
+    for (usize done = 0; done < count;) {
+        usize n = fox_mpmc_try_push_n(q, iter + done * q->chunksize,
+            count - done);
+
+        done += n;
+        if (n == 0)
+            _wait(&q->writers, &idle, _mpmc_has_room, q);
+    }
+}
+
+void fox_mpmc_pop_n(struct fox_mpmc *q, void *out, const usize count)
+{
+    u8 *iter = out;
+    u32 idle = 0;
+
+    for (usize done = 0; done < count;) {
+        usize n = fox_mpmc_try_pop_n(q, iter + done * q->chunksize,
+            count - done);
+
+        done += n;
+        if (n == 0)
+            _wait(&q->readers, &idle, _mpmc_has_items, q);
+    }
+}
+
+void fox_mpmc_push(struct fox_mpmc *q, const void *data)
+{
+    fox_mpmc_push_n(q, data, 1);
+}
+
+void fox_mpmc_pop(struct fox_mpmc *q, void *out)
+{
+    fox_mpmc_pop_n(q, out, 1);
+}
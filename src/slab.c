@@ -0,0 +1,237 @@
+#include <num.h>
+#include <alloc.h>
+
+#include <pthread.h>
+
+#include "alloc_private.h"
+
+#define SLAB_SPAN   (64 * 1024)
+#define SLAB_BATCH  32
+
+/*
+ * Blocks are handed out by a per-thread cache. When a cache runs dry it takes
+ * a whole batch from the central list of its size class, and once it holds
+ * two batches it gives one back. Blocks are not owned by a thread,
+ * so freeing from another thread simply lands the block in that cache.
+ */
+struct _slab_block {
+    struct _slab_block *next;   /* next block inside a batch */
+    struct _slab_block *batch;  /* next batch in the central list */
+    usize count;                /* blocks in this batch */
+};
+
+struct _slab_central {
+    pthread_mutex_t lock;
+    struct _slab_block *batches;
+};
+
+struct _slab_cache {
+    struct _slab_block *free[FOX_SLAB_CLASSES];
+    u32 count[FOX_SLAB_CLASSES];
+};
+
+static const u32 class_sizes[FOX_SLAB_CLASSES] = {
+    32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256,
+    320, 384, 448, 512,
+    640, 768, 896, 1024,
+    1280, 1536, 1792, 2048,
+    2560, 3072, 3584, 4096,
+    5120, 6144, 7168, 8192
+};
+
+static struct _slab_central central[FOX_SLAB_CLASSES];
+
+static __thread struct _slab_cache cache;
+static __thread bool registered = false;
+
+static pthread_once_t slab_once = PTHREAD_ONCE_INIT;
+static pthread_key_t slab_key;
+
+static void _slab_init();
+static void _slab_register();
+static void _slab_thread_exit(void *data);
+static struct _slab_block *_slab_refill(i32 cls);
+static void _slab_release(i32 cls, struct _slab_block *batch);
+
+i32 _fox_slab_class(usize total)
+{
+    if (total > FOX_SLAB_MAX)
+        return -1;
+
+    if (total <= 128)
+        return total <= 32 ? 0 : (i32) ((total + 15) / 16) - 2;
+
+    usize lg = sizeof(long) * 8 - 1 - __builtin_clzl(total - 1);
+
+    return (i32) (7 + (lg - 7) * 4 + ((total - 1) >> (lg - 2)) - 4);
+}
+
+usize _fox_slab_size(i32 cls)
+{
+    return class_sizes[cls];
+}
+
+void *_fox_slab_alloc(i32 cls)
+{
+    if (!registered)
+        _slab_register();
+
+    struct _slab_block *block = cache.free[cls];
+
+    if (block == NULL) {
+        block = _slab_refill(cls);
+        if (block == NULL)
+            return NULL;
+
+        cache.free[cls] = block;
+        cache.count[cls] = block->count;
+    }
+
+    cache.free[cls] = block->next;
+    cache.count[cls]--;
+
+    return block;
+}
+
+void _fox_slab_free(void *ptr, i32 cls)
+{
+    struct _slab_block *block = ptr;
+
+    if (!registered)
+        _slab_register();
+
+    block->next = cache.free[cls];
+    cache.free[cls] = block;
+
+    if (++cache.count[cls] < 2 * SLAB_BATCH)
+        return;
+
+    struct _slab_block *batch = cache.free[cls];
+    struct _slab_block *tail = batch;
+
+    for (u32 i = 1; i < SLAB_BATCH; i++)
+        tail = tail->next;
+
+    cache.free[cls] = tail->next;
+    cache.count[cls] -= SLAB_BATCH;
+    tail->next = NULL;
+
+    _slab_release(cls, batch);
+}
+
+static void _slab_init()
+{
+    for (i32 i = 0; i < FOX_SLAB_CLASSES; i++)
+        pthread_mutex_init(&central[i].lock, NULL);
+
+    pthread_key_create(&slab_key, _slab_thread_exit);
+}
+
+/* hands the cache back to the central lists when the thread exits */
+static void _slab_register()
+{
+    pthread_once(&slab_once, _slab_init);
+    pthread_setspecific(slab_key, &cache);
+    registered = true;
+}
+
+/*
+ * Another destructor may still free into the cache afterwards, clearing
+ * registered makes that free register again so the cache is drained on the
+ * next round of destructors.
+ */
+static void _slab_thread_exit(void *data)
+{
+    struct _slab_cache *c = data;
+
+    registered = false;
+
+    for (i32 i = 0; i < FOX_SLAB_CLASSES; i++) {
+        if (c->free[i] != NULL)
+            _slab_release(i, c->free[i]);
+
+        c->free[i] = NULL;
+        c->count[i] = 0;
+    }
+}
+
+static struct _slab_block *_slab_refill(i32 cls)
+{
+    struct _slab_central *c = central + cls;
+
+    pthread_mutex_lock(&c->lock);
+    struct _slab_block *batch = c->batches;
+    if (batch != NULL)
+        c->batches = batch->batch;
+    pthread_mutex_unlock(&c->lock);
+
+    if (batch != NULL)
+        return batch;
+
+    usize size = class_sizes[cls];
+    usize count = SLAB_SPAN / size;
+    count -= count % SLAB_BATCH;
+    if (count == 0)
+        count = SLAB_BATCH;
+
+    u8 *span = _fox_raw_alloc(count * size);
+    if (span == NULL)
+        return NULL;
+
+    struct _slab_block *first = NULL, *batches = NULL;
+
+    for (usize i = 0; i < count; i += SLAB_BATCH) {
+        struct _slab_block *head = (void*) (span + i * size);
+        head->count = SLAB_BATCH;
+
+        for (usize j = 0; j < SLAB_BATCH; j++) {
+            struct _slab_block *b = (void*) (span + (i + j) * size);
+            b->next = j + 1 < SLAB_BATCH ? (void*) ((u8*) b + size) : NULL;
+        }
+
+        if (first == NULL) {
+            first = head;
+        } else {
+            head->batch = batches;
+            batches = head;
+        }
+    }
+
+    if (batches != NULL) {
+        struct _slab_block *last = batches;
+        while (last->batch != NULL)
+            last = last->batch;
+
+        pthread_mutex_lock(&c->lock);
+        last->batch = c->batches;
+        c->batches = batches;
+        pthread_mutex_unlock(&c->lock);
+    }
+
+    return first;
+}
+
+/* cuts a NULL-terminated list into batches of at most SLAB_BATCH blocks */
+static void _slab_release(i32 cls, struct _slab_block *list)
+{
+    struct _slab_central *c = central + cls;
+
+    pthread_mutex_lock(&c->lock);
+
+    while (list != NULL) {
+        struct _slab_block *head = list, *tail = list;
+        usize n = 1;
+
+        for (; n < SLAB_BATCH && tail->next != NULL; n++)
+            tail = tail->next;
+
+        list = tail->next;
+        tail->next = NULL;
+        head->count = n;
+        head->batch = c->batches;
+        c->batches = head;
+    }
+
+    pthread_mutex_unlock(&c->lock);
+}
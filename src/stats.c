@@ -0,0 +1,188 @@
+#include <num.h>
+#include <alloc.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc_private.h"
+
+#define STATS_FLUSH (64 * 1024)
+
+/*
+ * Counters are kept per thread and only ever written by their own thread,
+ * readers sum every registered thread. Live bytes are kept as a per-thread
+ * delta that is folded into a global counter once it drifts by STATS_FLUSH,
+ * which is also when the peak is updated, so the peak may lag behind the
+ * true one by at most STATS_FLUSH bytes per thread.
+ */
+struct _stats_slot {
+    struct _stats_slot *next;
+    isize pending;
+    usize allocs;
+    usize frees;
+    usize grown;
+    usize moved;
+    usize histogram[FOX_ALLOC_BUCKETS];
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+
+static struct _stats_slot *slots = NULL;
+static struct _stats_slot retired = {0};
+static isize live = 0;
+static usize peak = 0;
+
+static __thread struct _stats_slot *slot = NULL;
+
+static void                 _stats_init();
+static void                 _stats_thread_exit(void *data);
+static struct _stats_slot  *_stats_slot();
+static void                 _stats_live(struct _stats_slot *s, isize delta);
+
+#define _bump(field) __atomic_store_n(&(field), (field) + 1, __ATOMIC_RELAXED)
+#define _load(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+void _fox_stats_alloc(usize size)
+{
+    struct _stats_slot *s = slot ? slot : _stats_slot();
+    if (s == NULL)
+        return;
+
+    usize bucket = size ? sizeof(long) * 8 - __builtin_clzl(size) : 0;
+    if (bucket >= FOX_ALLOC_BUCKETS)
+        bucket = FOX_ALLOC_BUCKETS - 1;
+
+    _bump(s->allocs);
+    _bump(s->histogram[bucket]);
+    _stats_live(s, size);
+}
+
+void _fox_stats_free(usize count, usize size)
+{
+    struct _stats_slot *s = slot ? slot : _stats_slot();
+    if (s == NULL)
+        return;
+
+    __atomic_store_n(&s->frees, s->frees + count, __ATOMIC_RELAXED);
+    _stats_live(s, -(isize) size);
+}
+
+void _fox_stats_realloc(usize old_size, usize new_size, bool moved)
+{
+    struct _stats_slot *s = slot ? slot : _stats_slot();
+    if (s == NULL)
+        return;
+
+    if (moved)
+        _bump(s->moved);
+    else
+        _bump(s->grown);
+
+    _stats_live(s, (isize) new_size - (isize) old_size);
+}
+
+struct fox_alloc_stats fox_alloc_stats()
+{
+    struct fox_alloc_stats stats = {0};
+    isize bytes;
+
+    pthread_mutex_lock(&lock);
+
+    bytes = _load(live) + retired.pending;
+    stats.allocs = retired.allocs;
+    stats.frees = retired.frees;
+    stats.reallocs_grown = retired.grown;
+    stats.reallocs_moved = retired.moved;
+    memcpy(stats.histogram, retired.histogram, sizeof(stats.histogram));
+
+    for (struct _stats_slot *s = slots; s != NULL; s = s->next) {
+        bytes += _load(s->pending);
+        stats.allocs += _load(s->allocs);
+        stats.frees += _load(s->frees);
+        stats.reallocs_grown += _load(s->grown);
+        stats.reallocs_moved += _load(s->moved);
+
+        for (usize i = 0; i < FOX_ALLOC_BUCKETS; i++)
+            stats.histogram[i] += _load(s->histogram[i]);
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    stats.live_bytes = bytes > 0 ? bytes : 0;
+    stats.peak_bytes = _load(peak);
+    if (stats.peak_bytes < stats.live_bytes)
+        stats.peak_bytes = stats.live_bytes;
+
+    return stats;
+}
+
+static void _stats_init()
+{
+    pthread_key_create(&stats_key, _stats_thread_exit);
+}
+
+static struct _stats_slot *_stats_slot()
+{
+    pthread_once(&stats_once, _stats_init);
+
+    struct _stats_slot *s = calloc(1, sizeof(*s));
+    if (s == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&lock);
+    s->next = slots;
+    slots = s;
+    pthread_mutex_unlock(&lock);
+
+    pthread_setspecific(stats_key, s);
+    slot = s;
+
+    return s;
+}
+
+static void _stats_thread_exit(void *data)
+{
+    struct _stats_slot *s = data;
+
+    pthread_mutex_lock(&lock);
+
+    struct _stats_slot **it = &slots;
+    while (*it != s)
+        it = &(*it)->next;
+    *it = s->next;
+
+    retired.pending += s->pending;
+    retired.allocs += s->allocs;
+    retired.frees += s->frees;
+    retired.grown += s->grown;
+    retired.moved += s->moved;
+
+    for (usize i = 0; i < FOX_ALLOC_BUCKETS; i++)
+        retired.histogram[i] += s->histogram[i];
+
+    pthread_mutex_unlock(&lock);
+
+    slot = NULL;
+    free(s);
+}
+
+static void _stats_live(struct _stats_slot *s, isize delta)
+{
+    isize pending = s->pending + delta;
+
+    if (pending > -STATS_FLUSH && pending < STATS_FLUSH) {
+        __atomic_store_n(&s->pending, pending, __ATOMIC_RELAXED);
+        return;
+    }
+
+    __atomic_store_n(&s->pending, 0, __ATOMIC_RELAXED);
+    isize now = __atomic_add_fetch(&live, pending, __ATOMIC_RELAXED);
+    usize seen = _load(peak);
+
+    while (now > 0 && (usize) now > seen && !__atomic_compare_exchange_n(&peak,
+        &seen, now, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
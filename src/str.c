@@ -0,0 +1,317 @@
+#include <alloc.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <utils.h>
+#include <num.h>
+#include <str.h>
+
+#define STR_HEAP    0xFF    /* tag of a string on the heap */
+
+static bool _grow(struct fox_str *s, const usize extra);
+
+static inline bool _on_heap(const struct fox_str *s)
+{
+    return s->u.small.tag == STR_HEAP;
+}
+
+static inline char *_data(struct fox_str *s)
+{
+    return _on_heap(s) ? s->u.heap.data : s->u.small.data;
+}
+
+static inline void _set_size(struct fox_str *s, const usize size)
+{
+    if (_on_heap(s))
+        s->u.heap.size = size;
+    else
+        s->u.small.tag = size;
+
+    _data(s)[size] = '\0';
+}
+
+struct fox_str fox_str_new(void)
+{
+    struct fox_str s;
+
+    memset(&s, 0, sizeof(s));
+    return s;
+}
+
+struct fox_str fox_str_from(const char *cstr)
+{
+    assert(cstr != NULL);
+    return fox_str_from_n(cstr, strlen(cstr));
+}
+
+struct fox_str fox_str_from_n(const void *data, const usize size)
+{
+    struct fox_str s = fox_str_new();
+
+    fox_str_append_n(&s, data, size);
+    return s;
+}
+
+struct fox_str fox_str_from_view(const struct fox_str_view view)
+{
+    return fox_str_from_n(view.data, view.size);
+}
+
+void fox_str_del(struct fox_str *s)
+{
+    assert(s != NULL);
+
+    if (_on_heap(s))
+        fox_free(s->u.heap.data);
+
+    *s = fox_str_new();
+}
+
+usize fox_str_size(const struct fox_str *s)
+{
+    assert(s != NULL);
+    return _on_heap(s) ? s->u.heap.size : s->u.small.tag;
+}
+
+usize fox_str_capacity(const struct fox_str *s)
+{
+    assert(s != NULL);
+
+    if (_on_heap(s))
+        return fox_allocated(s->u.heap.data) - 1;
+
+    return FOX_STR_INLINE;
+}
+
+const char *fox_str_cstr(const struct fox_str *s)
+{
+    assert(s != NULL);
+    return _on_heap(s) ? s->u.heap.data : s->u.small.data;
+}
+
+char *fox_str_data(struct fox_str *s)
+{
+    assert(s != NULL);
+    return _data(s);
+}
+
+bool fox_str_reserve(struct fox_str *s, const usize capacity)
+{
+    assert(s != NULL);
+
+    usize size = fox_str_size(s);
+
+    return capacity <= size || _grow(s, capacity - size);
+}
+
+void fox_str_clear(struct fox_str *s)
+{
+    assert(s != NULL);
+    _set_size(s, 0);
+}
+
+void fox_str_truncate(struct fox_str *s, const usize size)
+{
+    assert(s != NULL);
+
+    if (size < fox_str_size(s))
+        _set_size(s, size);
+}
+
+void fox_str_push(struct fox_str *s, const char c)
+{
+    assert(s != NULL);
+
+    usize size = fox_str_size(s);
+
+    if (!_grow(s, 1))
+        return;
+
+    _data(s)[size] = c;
+    _set_size(s, size + 1);
+}
+
+void fox_str_append(struct fox_str *s, const char *cstr)
+{
+    assert(cstr != NULL);
+    fox_str_append_n(s, cstr, strlen(cstr));
+}
+
+void fox_str_append_n(struct fox_str *s, const void *data, const usize size)
+{
+    assert(s != NULL);
+    assert(data != NULL || size == 0);
+
+    usize old = fox_str_size(s);
+    const char *from = data, *base = _data(s);
+
+    /* growing may move our own bytes, find them again afterwards */
+    bool inside = from >= base && from <= base + old;
+    usize offset = from - base;
+
+    if (!_grow(s, size))
+        return;
+
+    if (inside)
+        from = _data(s) + offset;
+
+    fox_memmove(_data(s) + old, from, size);
+    _set_size(s, old + size);
+}
+
+void fox_str_append_view(struct fox_str *s, const struct fox_str_view view)
+{
+    fox_str_append_n(s, view.data, view.size);
+}
+
+void fox_str_appendf(struct fox_str *s, const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    fox_str_vappendf(s, fmt, args);
+    va_end(args);
+}
+
+/* formats into the spare capacity, and a second time once it has grown */
+void fox_str_vappendf(struct fox_str *s, const char *fmt, va_list args)
+{
+    assert(s != NULL);
+    assert(fmt != NULL);
+
+    usize size = fox_str_size(s), room = fox_str_capacity(s) - size;
+    va_list again;
+
+    va_copy(again, args);
+    int n = vsnprintf(_data(s) + size, room + 1, fmt, args);
+
+    if (n >= 0 && (usize) n > room && _grow(s, n))
+        n = vsnprintf(_data(s) + size, n + 1, fmt, again);
+    else if (n >= 0 && (usize) n > room)
+        n = -1;
+
+    va_end(again);
+
+    _set_size(s, n >= 0 ? size + n : size);
+}
+
+struct fox_str_view fox_str_as_view(const struct fox_str *s)
+{
+    struct fox_str_view view = { fox_str_cstr(s), fox_str_size(s) };
+    return view;
+}
+
+struct fox_str_view fox_str_slice(const struct fox_str *s, usize start,
+    usize end)
+{
+    return fox_str_view_slice(fox_str_as_view(s), start, end);
+}
+
+isize fox_str_find(const struct fox_str *s, const struct fox_str_view needle)
+{
+    return fox_str_view_find(fox_str_as_view(s), needle);
+}
+
+struct fox_str_view fox_str_view_of(const char *cstr)
+{
+    assert(cstr != NULL);
+
+    struct fox_str_view view = { cstr, strlen(cstr) };
+    return view;
+}
+
+struct fox_str_view fox_str_view_slice(const struct fox_str_view view,
+    usize start, usize end)
+{
+    if (end > view.size)
+        end = view.size;
+    if (start > end)
+        start = end;
+
+    struct fox_str_view slice = { view.data + start, end - start };
+    return slice;
+}
+
+bool fox_str_view_equal(const struct fox_str_view a,
+    const struct fox_str_view b)
+{
+    return a.size == b.size && fox_memcompare(a.data, b.data, a.size) == 0;
+}
+
+isize fox_str_view_find(const struct fox_str_view haystack,
+    const struct fox_str_view needle)
+{
+    return fox_memsearch(haystack.data, haystack.size, needle.data,
+        needle.size);
+}
+
+isize fox_str_view_find_char(const struct fox_str_view haystack,
+    const char c)
+{
+    return fox_memfind(haystack.data, haystack.size, 1, &c);
+}
+
+/* a used up rest has no data left, unlike an empty last piece */
+bool fox_str_view_split(struct fox_str_view *rest,
+    const struct fox_str_view sep, struct fox_str_view *piece)
+{
+    assert(rest != NULL && piece != NULL);
+    assert(sep.size > 0);
+
+    if (rest->data == NULL)
+        return false;
+
+    isize at = fox_str_view_find(*rest, sep);
+
+    if (at < 0) {
+        *piece = *rest;
+        rest->data = NULL;
+        rest->size = 0;
+        return true;
+    }
+
+    piece->data = rest->data;
+    piece->size = at;
+    rest->data += at + sep.size;
+    rest->size -= at + sep.size;
+
+    return true;
+}
+
+/*
+ * Room for extra more bytes and the NUL. Capacity at least doubles, and a
+ * string leaving the struct copies its bytes out to the new block.
+ */
+static bool _grow(struct fox_str *s, const usize extra)
+{
+    usize size = fox_str_size(s), cap = fox_str_capacity(s);
+    usize needed = size + extra;
+
+    if (needed < size || needed + 1 == 0)
+        return false;
+
+    if (cap >= needed)
+        return true;
+
+    cap = cap > needed / 2 ? cap * 2 : needed;
+
+    if (_on_heap(s)) {
+        char *data = fox_realloc(s->u.heap.data, cap + 1);
+        if (data == NULL)
+            return false;
+
+        s->u.heap.data = data;
+        return true;
+    }
+
+    char *data = fox_alloc(cap + 1);
+    if (data == NULL)
+        return false;
+
+    fox_memcopy(data, s->u.small.data, size + 1);
+    s->u.heap.data = data;
+    s->u.heap.size = size;
+    s->u.small.tag = STR_HEAP;
+
+    return true;
+}
@@ -1,21 +1,651 @@
 #include <assert.h>
+#include <string.h>
 #include <num.h>
 #include <utils.h>
 
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+enum _scan_mode {
+    SCAN_FIRST,
+    SCAN_LAST,
+    SCAN_COUNT,
+};
+
+/* moves of at least this many bytes are left to libc, see fox_memmove */
+#define MEM_LARGE   (64 * 1024)
+
+typedef isize _scanner(const u8 *items, usize count, usize size,
+    const u8 *needle, enum _scan_mode mode);
+typedef isize _searcher(const u8 *haystack, usize n, const u8 *needle,
+    usize m);
+
+/*
+ * One set per instruction set, picked once by _kernels. copy runs forwards
+ * and copy_back backwards, both load a block before storing it so either is
+ * safe for the overlap its direction allows. fill repeats a 32-byte block.
+ */
+struct _kernels {
+    _scanner *scan;
+    _searcher *search;
+    void (*copy)(u8 *dest, const u8 *src, usize n);
+    void (*copy_back)(u8 *dest, const u8 *src, usize n);
+    void (*fill)(u8 *dest, usize n, const u8 *block);
+    int  (*compare)(const u8 *a, const u8 *b, usize n);
+};
+
+static const struct _kernels *_kernels();
+
+/*
+ * Up to 16 bytes as two overlapping loads of the widest size that fits,
+ * both done before either store so any overlap is fine.
+ */
+static inline void _move_small(u8 *d, const u8 *s, usize n)
+{
+    if (n >= 8) {
+        u64 a, b;
+        memcpy(&a, s, 8);
+        memcpy(&b, s + n - 8, 8);
+        memcpy(d, &a, 8);
+        memcpy(d + n - 8, &b, 8);
+    } else if (n >= 4) {
+        u32 a, b;
+        memcpy(&a, s, 4);
+        memcpy(&b, s + n - 4, 4);
+        memcpy(d, &a, 4);
+        memcpy(d + n - 4, &b, 4);
+    } else if (n > 0) {
+        u8 a = s[0], b = s[n / 2], c = s[n - 1];
+        d[0] = a;
+        d[n / 2] = b;
+        d[n - 1] = c;
+    }
+}
+
 void *fox_rmemcpy(void *dest, const void *src, usize n)
 {
     if (dest == NULL || src == NULL)
         return NULL;
 
+    _kernels()->copy_back(dest, src, n);
+
+    return dest;
+}
+
+void *fox_memcopy(void *dest, const void *src, usize n)
+{
+    if (n <= 16) {
+        _move_small(dest, src, n);
+        return dest;
+    }
+
+    if (n >= MEM_LARGE)
+        return memcpy(dest, src, n);
+
+    _kernels()->copy(dest, src, n);
+
+    return dest;
+}
+
+/*
+ * Past MEM_LARGE libc wins, it switches to rep movsb and non-temporal
+ * stores that keep a huge move from flushing the caches.
+ */
+void *fox_memmove(void *dest, const void *src, usize n)
+{
     u8 *d = dest;
     const u8 *s = src;
 
-    d += n - 1;
-    s += n - 1;
+    if (d == s)
+        return dest;
+
+    if (n <= 16) {
+        _move_small(d, s, n);
+        return dest;
+    }
+
+    if (n >= MEM_LARGE)
+        return memmove(dest, src, n);
+
+    if (d < s || d >= s + n)
+        _kernels()->copy(d, s, n);
+    else
+        _kernels()->copy_back(d, s, n);
+
+    return dest;
+}
+
+void *fox_memfill(void *dest, usize count, const void *pattern, usize size)
+{
+    assert(size > 0);
+
+    u8 *d = dest;
+    usize n = count * size;
+
+    if (n == 0)
+        return dest;
+
+    /* power of two patterns up to 32 bytes tile a 32-byte block */
+    if (size <= 32 && !(size & (size - 1))) {
+        u8 block[32];
+        u64 word = 0;
+
+        switch (size) {
+        case 1:
+            word = *(const u8*) pattern * 0x0101010101010101ull;
+            break;
+        case 2:
+            memcpy(&word, pattern, 2);
+            word *= 0x0001000100010001ull;
+            break;
+        case 4:
+            memcpy(&word, pattern, 4);
+            word *= 0x0000000100000001ull;
+            break;
+        case 8:
+            memcpy(&word, pattern, 8);
+            break;
+        case 16:
+            memcpy(block, pattern, 16);
+            memcpy(block + 16, pattern, 16);
+            break;
+        case 32:
+            memcpy(block, pattern, 32);
+            break;
+        }
+
+        if (size <= 8)
+            for (usize i = 0; i < sizeof(block); i += 8)
+                memcpy(block + i, &word, 8);
+
+        _kernels()->fill(d, n, block);
+        return dest;
+    }
+
+    /* any other size doubles what is already written */
+    memcpy(d, pattern, size);
+
+    for (usize done = size; done < n;) {
+        usize chunk = done < n - done ? done : n - done;
 
-    while (n--) {
-        *d-- = *s--;
+        fox_memcopy(d + done, d, chunk);
+        done += chunk;
     }
 
     return dest;
 }
+
+int fox_memcompare(const void *a, const void *b, usize n)
+{
+    return _kernels()->compare(a, b, n);
+}
+
+isize fox_memfind(const void *items, usize count, usize size,
+    const void *needle)
+{
+    assert(size > 0);
+    return _kernels()->scan(items, count, size, needle, SCAN_FIRST);
+}
+
+isize fox_memfind_last(const void *items, usize count, usize size,
+    const void *needle)
+{
+    assert(size > 0);
+    return _kernels()->scan(items, count, size, needle, SCAN_LAST);
+}
+
+usize fox_memcount(const void *items, usize count, usize size,
+    const void *needle)
+{
+    assert(size > 0);
+    return _kernels()->scan(items, count, size, needle, SCAN_COUNT);
+}
+
+isize fox_memsearch(const void *haystack, usize n, const void *needle,
+    usize m)
+{
+    if (m == 0)
+        return 0;
+    if (m > n)
+        return -1;
+    if (m == 1)
+        return fox_memfind(haystack, n, 1, needle);
+
+    return _kernels()->search(haystack, n, needle, m);
+}
+
+static inline bool _equal(const u8 *a, const u8 *b, usize size)
+{
+    switch (size) {
+    case 1:
+        return *a == *b;
+    case 2:
+        return memcmp(a, b, 2) == 0;
+    case 4:
+        return memcmp(a, b, 4) == 0;
+    case 8:
+        return memcmp(a, b, 8) == 0;
+    }
+
+    return memcmp(a, b, size) == 0;
+}
+
+/*
+ * Items from first to last, one at a time. The vector kernels hand the items
+ * that do not fill a whole register to it as well.
+ */
+static isize _scan_range(const u8 *items, usize first, usize last, usize size,
+    const u8 *needle, enum _scan_mode mode)
+{
+    isize found = 0;
+
+    if (mode == SCAN_LAST) {
+        for (usize i = last; i-- > first;)
+            if (_equal(items + i * size, needle, size))
+                return i;
+        return -1;
+    }
+
+    for (usize i = first; i < last; i++) {
+        if (_equal(items + i * size, needle, size)) {
+            if (mode == SCAN_FIRST)
+                return i;
+            found++;
+        }
+    }
+
+    return mode == SCAN_FIRST ? -1 : found;
+}
+
+static isize _scan_scalar(const u8 *items, usize count, usize size,
+    const u8 *needle, enum _scan_mode mode)
+{
+    return _scan_range(items, 0, count, size, needle, mode);
+}
+
+/* positions from first on, m is at least 2 and at most n */
+static isize _search_range(const u8 *h, usize first, usize n, const u8 *s,
+    usize m)
+{
+    for (usize i = first; i + m <= n; i++) {
+        const u8 *p = memchr(h + i, s[0], n - m + 1 - i);
+
+        if (p == NULL)
+            return -1;
+
+        i = p - h;
+        if (p[m - 1] == s[m - 1] && memcmp(p + 1, s + 1, m - 2) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+static isize _search_scalar(const u8 *h, usize n, const u8 *s, usize m)
+{
+    return _search_range(h, 0, n, s, m);
+}
+
+static inline u64 _load_word(const u8 *p)
+{
+    u64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void _store_word(u8 *p, u64 v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+/*
+ * Moves, fills and compares for one register type. Long moves first align
+ * the destination so no store splits a cache line, then four registers are
+ * loaded before any is stored. What does not fill a register goes a word
+ * and then a byte at a time. eq gives a register with all bits set where
+ * the bytes match, and_ combines two of them and all tells whether every
+ * bit is set. attr holds the target attribute of the instruction set.
+ */
+#define MEM_KERNELS(name, attr, reg, load, store, eq, and_, all)            \
+attr static void _copy_##name(u8 *d, const u8 *s, usize n)                  \
+{                                                                           \
+    const usize w = sizeof(reg);                                            \
+                                                                            \
+    if (n >= 8 * w) {                                                       \
+        usize head = -(uintptr_t) d & (w - 1);                              \
+        for (n -= head; head > 0; head--)                                   \
+            *d++ = *s++;                                                    \
+    }                                                                       \
+                                                                            \
+    for (; n >= 4 * w; n -= 4 * w, d += 4 * w, s += 4 * w) {               \
+        reg a = load(s), b = load(s + w), c = load(s + 2 * w),              \
+            e = load(s + 3 * w);                                            \
+        store(d, a);                                                        \
+        store(d + w, b);                                                    \
+        store(d + 2 * w, c);                                                \
+        store(d + 3 * w, e);                                                \
+    }                                                                       \
+                                                                            \
+    for (; n >= w; n -= w, d += w, s += w)                                  \
+        store(d, load(s));                                                  \
+    for (; n >= 8; n -= 8, d += 8, s += 8)                                  \
+        _store_word(d, _load_word(s));                                     \
+    while (n--)                                                             \
+        *d++ = *s++;                                                        \
+}                                                                           \
+                                                                            \
+attr static void _copy_back_##name(u8 *d, const u8 *s, usize n)             \
+{                                                                           \
+    const usize w = sizeof(reg);                                            \
+                                                                            \
+    d += n;                                                                 \
+    s += n;                                                                 \
+                                                                            \
+    if (n >= 8 * w) {                                                       \
+        usize tail = (uintptr_t) d & (w - 1);                               \
+        for (n -= tail; tail > 0; tail--)                                   \
+            *--d = *--s;                                                    \
+    }                                                                       \
+                                                                            \
+    for (; n >= 4 * w; n -= 4 * w) {                                        \
+        d -= 4 * w;                                                         \
+        s -= 4 * w;                                                         \
+        reg a = load(s), b = load(s + w), c = load(s + 2 * w),              \
+            e = load(s + 3 * w);                                            \
+        store(d + 3 * w, e);                                                \
+        store(d + 2 * w, c);                                                \
+        store(d + w, b);                                                    \
+        store(d, a);                                                        \
+    }                                                                       \
+                                                                            \
+    for (; n >= w; n -= w) {                                                \
+        d -= w;                                                             \
+        s -= w;                                                             \
+        store(d, load(s));                                                  \
+    }                                                                       \
+                                                                            \
+    for (; n >= 8; n -= 8) {                                                \
+        d -= 8;                                                             \
+        s -= 8;                                                             \
+        _store_word(d, _load_word(s));                                     \
+    }                                                                       \
+                                                                            \
+    while (n--)                                                             \
+        *--d = *--s;                                                        \
+}                                                                           \
+                                                                            \
+attr static void _fill_##name(u8 *d, usize n, const u8 *block)              \
+{                                                                           \
+    const usize w = sizeof(reg);                                            \
+    reg r[32 / sizeof(reg)];                                                \
+                                                                            \
+    for (usize i = 0; i < 32 / w; i++)                                      \
+        r[i] = load(block + i * w);                                         \
+                                                                            \
+    for (; n >= 32; n -= 32, d += 32)                                       \
+        for (usize i = 0; i < 32 / w; i++)                                  \
+            store(d + i * w, r[i]);                                         \
+                                                                            \
+    usize i = 0;                                                            \
+    for (; i + 8 <= n; i += 8)                                              \
+        _store_word(d + i, _load_word(block + i));                          \
+    for (; i < n; i++)                                                      \
+        d[i] = block[i];                                                    \
+}                                                                           \
+                                                                            \
+attr static int _compare_##name(const u8 *a, const u8 *b, usize n)          \
+{                                                                           \
+    const usize w = sizeof(reg);                                            \
+                                                                            \
+    for (; n >= 4 * w; n -= 4 * w, a += 4 * w, b += 4 * w) {               \
+        reg x = and_(eq(load(a), load(b)), eq(load(a + w), load(b + w)));   \
+        reg y = and_(eq(load(a + 2 * w), load(b + 2 * w)),                  \
+            eq(load(a + 3 * w), load(b + 3 * w)));                          \
+        if (!all(and_(x, y)))                                               \
+            break;                                                          \
+    }                                                                       \
+                                                                            \
+    for (; n >= w; n -= w, a += w, b += w)                                  \
+        if (!all(eq(load(a), load(b))))                                     \
+            break;                                                          \
+    for (; n >= 8; n -= 8, a += 8, b += 8)                                  \
+        if (_load_word(a) != _load_word(b))                                 \
+            break;                                                          \
+                                                                            \
+    for (; n > 0; n--, a++, b++)                                            \
+        if (*a != *b)                                                       \
+            return *a - *b;                                                 \
+                                                                            \
+    return 0;                                                               \
+}
+
+#define WORD_EQ(a, b)       (~((a) ^ (b)))
+#define WORD_AND(a, b)      ((a) & (b))
+#define WORD_ALL(a)         ((a) == ~(u64) 0)
+
+MEM_KERNELS(word, , u64, _load_word, _store_word, WORD_EQ, WORD_AND,
+    WORD_ALL)
+
+#ifdef __SSE2__
+
+/*
+ * Compare-and-movemask kernels. movemask gives one bit per byte, an item of
+ * size bytes matches when the bit of its first byte survives the lane mask,
+ * so the item index is the bit index divided by size. 8-byte items are
+ * compared as two 4-byte halves with SSE2, which has no 64-bit compare.
+ */
+#define SCAN_LOOP(width, load_mask)                                         \
+    do {                                                                    \
+        usize per = (width) / size, blocks = count / per;                   \
+        isize found = 0;                                                    \
+                                                                            \
+        if (mode == SCAN_LAST) {                                            \
+            isize tail = _scan_range(items, blocks * per, count, size,      \
+                needle, mode);                                              \
+            if (tail >= 0)                                                  \
+                return tail;                                                \
+                                                                            \
+            for (usize b = blocks; b-- > 0;) {                              \
+                u32 m = load_mask(items + b * (width));                     \
+                if (m)                                                      \
+                    return b * per + (31 - __builtin_clz(m)) / size;        \
+            }                                                               \
+                                                                            \
+            return -1;                                                      \
+        }                                                                   \
+                                                                            \
+        for (usize b = 0; b < blocks; b++) {                                \
+            u32 m = load_mask(items + b * (width));                         \
+                                                                            \
+            if (mode == SCAN_FIRST) {                                       \
+                if (m)                                                      \
+                    return b * per + __builtin_ctz(m) / size;               \
+            } else {                                                        \
+                found += __builtin_popcount(m);                             \
+            }                                                               \
+        }                                                                   \
+                                                                            \
+        isize tail = _scan_range(items, blocks * per, count, size, needle,  \
+            mode);                                                          \
+                                                                            \
+        if (mode == SCAN_FIRST)                                             \
+            return tail;                                                    \
+                                                                            \
+        return found + tail;                                                \
+    } while (0)
+
+static isize _scan_sse2(const u8 *items, usize count, usize size,
+    const u8 *needle, enum _scan_mode mode)
+{
+    __m128i n;
+    u64 value = 0;
+
+    if (size > sizeof(value) || size & (size - 1))
+        return _scan_scalar(items, count, size, needle, mode);
+
+    memcpy(&value, needle, size);
+
+#define MASK8(p) ((u32) _mm_movemask_epi8(_mm_cmpeq_epi8(                  \
+    _mm_loadu_si128((const __m128i*) (p)), n)))
+#define MASK16(p) ((u32) _mm_movemask_epi8(_mm_cmpeq_epi16(                \
+    _mm_loadu_si128((const __m128i*) (p)), n)) & 0x5555)
+#define MASK32(p) ((u32) _mm_movemask_epi8(_mm_cmpeq_epi32(                \
+    _mm_loadu_si128((const __m128i*) (p)), n)) & 0x1111)
+#define MASK64(p) (MASK32(p) & (MASK32(p) >> 4) & 0x0101)
+
+    switch (size) {
+    case 1:
+        n = _mm_set1_epi8(value);
+        SCAN_LOOP(16, MASK8);
+    case 2:
+        n = _mm_set1_epi16(value);
+        SCAN_LOOP(16, MASK16);
+    case 4:
+        n = _mm_set1_epi32(value);
+        SCAN_LOOP(16, MASK32);
+    case 8:
+        n = _mm_set1_epi64x(value);
+        SCAN_LOOP(16, MASK64);
+    }
+
+#undef MASK8
+#undef MASK16
+#undef MASK32
+#undef MASK64
+
+    return _scan_scalar(items, count, size, needle, mode);
+}
+
+__attribute__((target("avx2,popcnt")))
+static isize _scan_avx2(const u8 *items, usize count, usize size,
+    const u8 *needle, enum _scan_mode mode)
+{
+    __m256i n;
+    u64 value = 0;
+
+    if (size > sizeof(value) || size & (size - 1))
+        return _scan_scalar(items, count, size, needle, mode);
+
+    memcpy(&value, needle, size);
+
+#define MASK8(p) ((u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(            \
+    _mm256_loadu_si256((const __m256i*) (p)), n)))
+#define MASK16(p) ((u32) _mm256_movemask_epi8(_mm256_cmpeq_epi16(          \
+    _mm256_loadu_si256((const __m256i*) (p)), n)) & 0x55555555)
+#define MASK32(p) ((u32) _mm256_movemask_epi8(_mm256_cmpeq_epi32(          \
+    _mm256_loadu_si256((const __m256i*) (p)), n)) & 0x11111111)
+#define MASK64(p) ((u32) _mm256_movemask_epi8(_mm256_cmpeq_epi64(          \
+    _mm256_loadu_si256((const __m256i*) (p)), n)) & 0x01010101)
+
+    switch (size) {
+    case 1:
+        n = _mm256_set1_epi8(value);
+        SCAN_LOOP(32, MASK8);
+    case 2:
+        n = _mm256_set1_epi16(value);
+        SCAN_LOOP(32, MASK16);
+    case 4:
+        n = _mm256_set1_epi32(value);
+        SCAN_LOOP(32, MASK32);
+    case 8:
+        n = _mm256_set1_epi64x(value);
+        SCAN_LOOP(32, MASK64);
+    }
+
+#undef MASK8
+#undef MASK16
+#undef MASK32
+#undef MASK64
+
+    return _scan_scalar(items, count, size, needle, mode);
+}
+
+/*
+ * Substring search a register of positions at a time: a position is a
+ * candidate when both the first and the last byte of the needle match
+ * there, only candidates have their middle compared. Rare pairs make for
+ * few of them even when the first byte alone is common.
+ */
+#define SEARCH_KERNEL(name, attr, reg, load, set1, eq, and_, movemask)      \
+attr static isize _search_##name(const u8 *h, usize n, const u8 *s,         \
+    usize m)                                                                \
+{                                                                           \
+    const usize w = sizeof(reg);                                            \
+    reg first = set1(s[0]), last = set1(s[m - 1]);                          \
+    usize i = 0;                                                            \
+                                                                            \
+    for (; i + m - 1 + w <= n; i += w) {                                    \
+        u32 mask = movemask(and_(eq(load(h + i), first),                    \
+            eq(load(h + i + m - 1), last)));                                \
+                                                                            \
+        for (; mask != 0; mask &= mask - 1) {                               \
+            usize at = i + __builtin_ctz(mask);                             \
+                                                                            \
+            if (memcmp(h + at + 1, s + 1, m - 2) == 0)                      \
+                return at;                                                  \
+        }                                                                   \
+    }                                                                       \
+                                                                            \
+    return _search_range(h, i, n, s, m);                                    \
+}
+
+#define SSE2_LOAD(p)        _mm_loadu_si128((const __m128i*) (p))
+#define SSE2_STORE(p, v)    _mm_storeu_si128((__m128i*) (p), (v))
+#define SSE2_ALL(a)         (_mm_movemask_epi8(a) == 0xFFFF)
+
+MEM_KERNELS(sse2, , __m128i, SSE2_LOAD, SSE2_STORE, _mm_cmpeq_epi8,
+    _mm_and_si128, SSE2_ALL)
+SEARCH_KERNEL(sse2, , __m128i, SSE2_LOAD, _mm_set1_epi8, _mm_cmpeq_epi8,
+    _mm_and_si128, _mm_movemask_epi8)
+
+#define AVX2_LOAD(p)        _mm256_loadu_si256((const __m256i*) (p))
+#define AVX2_STORE(p, v)    _mm256_storeu_si256((__m256i*) (p), (v))
+#define AVX2_ALL(a)         ((u32) _mm256_movemask_epi8(a) == 0xFFFFFFFF)
+
+MEM_KERNELS(avx2, __attribute__((target("avx2"))), __m256i, AVX2_LOAD,
+    AVX2_STORE, _mm256_cmpeq_epi8, _mm256_and_si256, AVX2_ALL)
+SEARCH_KERNEL(avx2, __attribute__((target("avx2"))), __m256i, AVX2_LOAD,
+    _mm256_set1_epi8, _mm256_cmpeq_epi8, _mm256_and_si256,
+    _mm256_movemask_epi8)
+
+#endif
+
+/* resolved on first use, every thread picks the same set */
+static const struct _kernels *_kernels()
+{
+    static const struct _kernels word = {
+        _scan_scalar, _search_scalar, _copy_word, _copy_back_word, _fill_word,
+        _compare_word,
+    };
+#ifdef __SSE2__
+    static const struct _kernels sse2 = {
+        _scan_sse2, _search_sse2, _copy_sse2, _copy_back_sse2, _fill_sse2,
+        _compare_sse2,
+    };
+    static const struct _kernels avx2 = {
+        _scan_avx2, _search_avx2, _copy_avx2, _copy_back_avx2, _fill_avx2,
+        _compare_avx2,
+    };
+#endif
+    static const struct _kernels *kernels = NULL;
+    const struct _kernels *picked =
+        __atomic_load_n(&kernels, __ATOMIC_RELAXED);
+
+    if (picked != NULL)
+        return picked;
+
+    picked = &word;
+
+#ifdef __SSE2__
+    picked = &sse2;
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+        picked = &avx2;
+#endif
+
+    __atomic_store_n(&kernels, picked, __ATOMIC_RELAXED);
+
+    return picked;
+}
@@ -1,4 +1,5 @@
 #include <alloc.h>
+#include <arena.h>
 #include <assert.h>
 #include <utils.h>
 #include <string.h>
@@ -6,6 +7,32 @@
 #include <fns.h>
 #include <vec.h>
 
+#define SORT_INSERTION  24      /* introsort leaves shorter ranges */
+#define SORT_NINTHER    128     /* pivot from 9 items above this */
+#define SORT_PARTIAL    8       /* moves allowed on an almost sorted range */
+#define SORT_RUN        16      /* merge sort leaves shorter runs */
+#define ROTATE_BUFFER   512     /* bytes a rotation may stage on the stack */
+
+struct _sorter {
+    usize size;
+    comparar *comparar;
+};
+
+struct _keyed {
+    u64 key;
+    usize index;
+};
+
+static bool _grow(struct fox_vec *vec, const usize extra);
+static void _introsort(const struct _sorter *s, u8 *lo, usize n, u32 bad);
+static void _merge_sort(const struct _sorter *s, u8 *lo, usize n, u8 *tmp);
+static void _insertion_sort(const struct _sorter *s, u8 *lo, usize n);
+static void _insertion_sort_by_key(u8 *lo, usize n, usize size,
+                keyof *keyof);
+static inline void _copy(u8 *dest, const u8 *src, usize size);
+static inline bool _less(const struct _sorter *s, const u8 *a, const u8 *b);
+static void _rotate(u8 *p, usize left, usize right);
+
 struct fox_vec fox_vec_new(const usize chunksize)
 {
     assert(chunksize > 0);
@@ -14,6 +41,35 @@ struct fox_vec fox_vec_new(const usize chunksize)
     return vec;
 }
 
+struct fox_vec fox_vec_new_aligned(const usize chunksize,
+    const usize alignment)
+{
+    assert(chunksize > 0);
+    struct fox_vec vec = { .chunksize = chunksize, 0 };
+    vec.items = fox_alloc_aligned(16 * chunksize, alignment);
+    return vec;
+}
+
+struct fox_vec fox_vec_new_in(struct fox_arena *arena, const usize chunksize)
+{
+    assert(arena != NULL);
+    assert(chunksize > 0);
+    struct fox_vec vec = { .chunksize = chunksize, 0 };
+    vec.items = fox_arena_alloc(arena, 16 * chunksize);
+    return vec;
+}
+
+struct fox_vec fox_vec_new_inline(const usize chunksize, void *buf,
+    const usize size)
+{
+    assert(chunksize > 0);
+    struct fox_vec vec = { .chunksize = chunksize, 0 };
+    vec.items = fox_alloc_inline(buf, size);
+    if (vec.items == NULL)
+        vec.items = fox_reallocarray(vec.items, 16, chunksize);
+    return vec;
+}
+
 void fox_vec_del(struct fox_vec *vec, deletor *deletor)
 {
     assert(vec != NULL);
@@ -26,6 +82,9 @@ void fox_vec_del(struct fox_vec *vec, deletor *deletor)
         iter += vec->chunksize;
     }
 
+    if (fox_vec_is_mapped(vec))
+        fox_vec_map_sync(vec, false);
+
     fox_free(vec->items);
 }
 
@@ -34,18 +93,56 @@ void fox_vec_push(struct fox_vec *vec, void *data)
     assert(vec != NULL);
     assert(data != NULL);
 
-    usize cap = fox_allocated(vec->items) / vec->chunksize;
-    assert(cap > vec->size);
-    if (cap == vec->size)
-        vec->items = fox_reallocarray(vec->items, vec->size * 2,
-            vec->chunksize);
+    if (!_grow(vec, 1))
+        return;
 
     u8 *iter = vec->items;
 
-    memcpy(iter + vec->size * vec->chunksize, data, vec->chunksize);
+    _copy(iter + vec->size * vec->chunksize, data, vec->chunksize);
     vec->size++;
 }
 
+void fox_vec_push_n(struct fox_vec *vec, const void *data, const usize count)
+{
+    assert(vec != NULL);
+    assert(data != NULL || count == 0);
+
+    u8 *dest = fox_vec_append_uninit(vec, count);
+
+    if (dest != NULL)
+        fox_memcopy(dest, data, count * vec->chunksize);
+}
+
+void fox_vec_extend(struct fox_vec *vec, const struct fox_vec *other)
+{
+    assert(vec != NULL);
+    assert(other != NULL);
+    assert(vec->chunksize == other->chunksize);
+
+    /* other may be vec itself, its items are only read after growing */
+    usize count = other->size;
+
+    if (!_grow(vec, count))
+        return;
+
+    fox_memcopy((u8*) vec->items + vec->size * vec->chunksize, other->items,
+        count * vec->chunksize);
+    vec->size += count;
+}
+
+void *fox_vec_append_uninit(struct fox_vec *vec, const usize count)
+{
+    assert(vec != NULL);
+
+    if (!_grow(vec, count))
+        return NULL;
+
+    u8 *span = (u8*) vec->items + vec->size * vec->chunksize;
+    vec->size += count;
+
+    return span;
+}
+
 void fox_vec_insert(struct fox_vec *vec, const usize index, void *data)
 {
     assert(vec != NULL);
@@ -56,58 +153,84 @@ void fox_vec_insert(struct fox_vec *vec, const usize index, void *data)
         return;
     }
 
-    usize cap = fox_allocated(vec->items) / vec->chunksize;
-    assert(cap > vec->size);
-    if (cap == vec->size)
-        vec->items = fox_reallocarray(vec->items, vec->size * 2,
-            vec->chunksize);
+    if (!_grow(vec, 1))
+        return;
 
     u8 *iter = vec->items;
-    fox_rmemcpy(iter + vec->chunksize * (index + 1),
+    fox_memmove(iter + vec->chunksize * (index + 1),
         iter + vec->chunksize * index,
         (vec->size - index) * vec->chunksize);
 
-    memcpy(iter + index * vec->chunksize, data, vec->chunksize);
+    _copy(iter + index * vec->chunksize, data, vec->chunksize);
     vec->size++;
 }
 
+void fox_vec_insert_n(struct fox_vec *vec, const usize index,
+    const void *data, const usize count)
+{
+    assert(vec != NULL);
+    assert(data != NULL || count == 0);
+
+    if (index >= vec->size) {
+        fox_vec_push_n(vec, data, count);
+        return;
+    }
+
+    if (!_grow(vec, count))
+        return;
+
+    u8 *iter = vec->items;
+    fox_memmove(iter + vec->chunksize * (index + count),
+        iter + vec->chunksize * index,
+        (vec->size - index) * vec->chunksize);
+
+    fox_memcopy(iter + index * vec->chunksize, data, count * vec->chunksize);
+    vec->size += count;
+}
+
 void fox_vec_fill(struct fox_vec *vec, void *data)
 {
     assert(vec != NULL);
     assert(data != NULL);
 
     usize cap = fox_allocated(vec->items) / vec->chunksize;
-    assert(cap > vec->size);
+    assert(cap >= vec->size);
 
     if (cap == vec->size)
         return;
 
-    for (usize i = vec->size; i < cap; i++)
-        memcpy(vec->items + i * vec->chunksize, data, vec->chunksize);
+    fox_memfill((u8*) vec->items + vec->size * vec->chunksize, cap - vec->size,
+        data, vec->chunksize);
 
     vec->size = cap;
 }
 
-void fox_vec_rotate(struct fox_vec *vec, const isize rotation) 
+void fox_vec_rotate(struct fox_vec *vec, const isize rotation)
 {
     assert(vec != NULL);
-    u8 *iter = vec->items;
+    fox_vec_rotate_range(vec, 0, vec->size, rotation);
+}
 
-    if (rotation < 0) {
-        u8 data_buffer[vec->chunksize + (-rotation)];
-        memcpy(data_buffer, iter, vec->chunksize * (-rotation));
-        memcpy(iter, iter + (-rotation) * vec->chunksize,
-            (vec->size - (-rotation)) * vec->chunksize);
-        memcpy(iter + (vec->size - (-rotation)) * vec->chunksize,
-            data_buffer, vec->chunksize * (-rotation));
-    } else if (rotation > 0) {
-        u8 data_buffer[vec->chunksize + rotation];
-        memcpy(data_buffer, iter + (vec->size - rotation) * vec->chunksize,
-            vec->chunksize * rotation);
-        fox_rmemcpy(iter + rotation * vec->chunksize, iter,
-            (vec->size - rotation) * vec->chunksize);
-        memcpy(iter, data_buffer, vec->chunksize * rotation);
-    }
+void fox_vec_rotate_range(struct fox_vec *vec, const usize start, usize end,
+    const isize rotation)
+{
+    assert(vec != NULL);
+
+    if (end > vec->size)
+        end = vec->size;
+    if (start >= end)
+        return;
+
+    usize n = end - start;
+    isize right = rotation % (isize) n;
+
+    if (right < 0)
+        right += n;
+    if (right == 0)
+        return;
+
+    _rotate((u8*) vec->items + start * vec->chunksize,
+        (n - right) * vec->chunksize, right * vec->chunksize);
 }
 
 void *fox_vec_front(const struct fox_vec *vec)
@@ -150,6 +273,34 @@ void fox_vec_pop(struct fox_vec *vec, deletor *deletor)
 }
 
 void fox_vec_remove(struct fox_vec *vec, const usize index, deletor *deletor)
+{
+    fox_vec_remove_range(vec, index, index + 1, deletor);
+}
+
+void fox_vec_remove_range(struct fox_vec *vec, const usize start, usize end,
+    deletor *deletor)
+{
+    assert(vec != NULL);
+
+    if (end > vec->size)
+        end = vec->size;
+    if (start >= end)
+        return;
+
+    u8 *iter = vec->items;
+
+    if (deletor != NULL)
+        for (usize i = start; i < end; i++)
+            deletor(iter + vec->chunksize * i);
+
+    fox_memmove(iter + vec->chunksize * start, iter + vec->chunksize * end,
+        (vec->size - end) * vec->chunksize);
+
+    vec->size -= end - start;
+}
+
+void fox_vec_swap_remove(struct fox_vec *vec, const usize index,
+    deletor *deletor)
 {
     assert(vec != NULL);
     if (index >= vec->size)
@@ -160,11 +311,74 @@ void fox_vec_remove(struct fox_vec *vec, const usize index, deletor *deletor)
     if (deletor != NULL)
         deletor(iter + vec->chunksize * index);
 
-    memcpy(iter + vec->chunksize * index,
-        iter + vec->chunksize * (index + 1),
-        (vec->size - index - 1) * vec->chunksize);
-
     vec->size--;
+
+    if (index != vec->size)
+        _copy(iter + vec->chunksize * index, iter + vec->chunksize * vec->size,
+            vec->chunksize);
+}
+
+/*
+ * One pass: kept items are moved down a run at a time, a run ends at the
+ * first item dropped after it.
+ */
+void fox_vec_retain(struct fox_vec *vec, predicate *keep, deletor *deletor)
+{
+    assert(vec != NULL);
+    assert(keep != NULL);
+
+    usize size = vec->chunksize, kept = 0, run = 0;
+    u8 *iter = vec->items;
+
+    for (usize i = 0; i < vec->size; i++) {
+        if (keep(iter + i * size))
+            continue;
+
+        if (deletor != NULL)
+            deletor(iter + i * size);
+
+        if (i > run && kept != run)
+            fox_memmove(iter + kept * size, iter + run * size,
+                (i - run) * size);
+
+        kept += i - run;
+        run = i + 1;
+    }
+
+    if (vec->size > run && kept != run)
+        fox_memmove(iter + kept * size, iter + run * size,
+            (vec->size - run) * size);
+
+    vec->size = kept + vec->size - run;
+}
+
+void fox_vec_dedup(struct fox_vec *vec, comparar *comparar, deletor *deletor)
+{
+    assert(vec != NULL);
+
+    usize size = vec->chunksize, kept = 1;
+    u8 *iter = vec->items;
+
+    if (vec->size < 2)
+        return;
+
+    for (usize i = 1; i < vec->size; i++) {
+        u8 *item = iter + i * size, *last = iter + (kept - 1) * size;
+        bool same = comparar != NULL ? comparar(item, last) :
+            fox_memcompare(item, last, size) == 0;
+
+        if (same) {
+            if (deletor != NULL)
+                deletor(item);
+            continue;
+        }
+
+        if (kept != i)
+            _copy(iter + kept * size, item, size);
+        kept++;
+    }
+
+    vec->size = kept;
 }
 
 void fox_vec_reserve(struct fox_vec *vec, const usize capacity)
@@ -199,12 +413,13 @@ bool fox_vec_is_sorted(const struct fox_vec *vec, comparar *comparar)
 
     u8 *iter = vec->items;
 
-    for (usize i = 0; i < vec->size - 1; i++) {
+    for (usize i = 0; i + 1 < vec->size; i++) {
         if (comparar != NULL) {
             if (!comparar(iter, iter + vec->chunksize))
                 return false;
         } else {
-            if (memcmp(iter, iter + vec->chunksize, vec->chunksize) > 0)
+            if (fox_memcompare(iter, iter + vec->chunksize,
+                vec->chunksize) > 0)
                 return false;
         }
 
@@ -214,21 +429,119 @@ bool fox_vec_is_sorted(const struct fox_vec *vec, comparar *comparar)
     return true;
 }
 
+void fox_vec_sort(struct fox_vec *vec, comparar *comparar)
+{
+    assert(vec != NULL);
+
+    struct _sorter s = { vec->chunksize, comparar };
+    u32 bad = 0;
+
+    /* unbalanced partitions allowed before falling back to heapsort */
+    for (usize n = vec->size; n > 1; n >>= 1)
+        bad++;
+
+    _introsort(&s, vec->items, vec->size, bad);
+}
+
+void fox_vec_stable_sort(struct fox_vec *vec, comparar *comparar)
+{
+    assert(vec != NULL);
+
+    struct _sorter s = { vec->chunksize, comparar };
+    u8 *tmp = NULL;
+
+    if (vec->size > SORT_RUN)
+        tmp = fox_reallocarray(NULL, vec->size / 2, vec->chunksize);
+
+    if (tmp == NULL) {
+        _insertion_sort(&s, vec->items, vec->size);
+        return;
+    }
+
+    _merge_sort(&s, vec->items, vec->size, tmp);
+    fox_free(tmp);
+}
+
+void fox_vec_sort_by_key(struct fox_vec *vec, keyof *keyof)
+{
+    assert(vec != NULL);
+    assert(keyof != NULL);
+
+    usize n = vec->size, size = vec->chunksize;
+    u8 *items = vec->items;
+
+    if (n < 2)
+        return;
+
+    struct _keyed *keys = fox_reallocarray(NULL, n, 2 * sizeof(*keys));
+    u8 *sorted = fox_reallocarray(NULL, n, size);
+
+    if (keys == NULL || sorted == NULL) {
+        fox_free(keys);
+        fox_free(sorted);
+        _insertion_sort_by_key(items, n, size, keyof);
+        return;
+    }
+
+    /* one pass for the histograms of all 8 digits */
+    usize counts[8][256] = {{0}};
+
+    for (usize i = 0; i < n; i++) {
+        u64 key = keyof(items + i * size);
+
+        keys[i].key = key;
+        keys[i].index = i;
+
+        for (u32 d = 0; d < 8; d++)
+            counts[d][(key >> d * 8) & 0xFF]++;
+    }
+
+    struct _keyed *from = keys, *to = keys + n;
+
+    for (u32 d = 0; d < 8; d++) {
+        usize *count = counts[d];
+        usize offset = 0;
+
+        /* every key has the same digit here, the pass would change nothing */
+        if (count[(from[0].key >> d * 8) & 0xFF] == n)
+            continue;
+
+        for (u32 b = 0; b < 256; b++) {
+            usize c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+
+        for (usize i = 0; i < n; i++)
+            to[count[(from[i].key >> d * 8) & 0xFF]++] = from[i];
+
+        struct _keyed *tmp = from;
+        from = to;
+        to = tmp;
+    }
+
+    for (usize i = 0; i < n; i++)
+        _copy(sorted + i * size, items + from[i].index * size, size);
+
+    fox_memcopy(items, sorted, n * size);
+
+    fox_free(keys);
+    fox_free(sorted);
+}
+
 isize fox_vec_find(const struct fox_vec *vec, const void *needle,
     comparar *comparar)
 {
     assert(vec != NULL);
 
+    if (comparar == NULL)
+        return fox_memfind(vec->items, vec->size, vec->chunksize, needle);
+
     u8 *iter = vec->items;
 
     for (usize i = 0; i < vec->size; i++) {
-        if (comparar != NULL) {
-            if (comparar(iter, needle))
-                return i;
-        } else {
-            if (memcmp(iter, needle, vec->chunksize) == 0)
-                return i;
-        }
+        if (comparar(iter, needle))
+            return i;
 
         iter += vec->chunksize;
     }
@@ -236,9 +549,472 @@ isize fox_vec_find(const struct fox_vec *vec, const void *needle,
     return -1;
 }
 
+isize fox_vec_find_last(const struct fox_vec *vec, const void *needle,
+    comparar *comparar)
+{
+    assert(vec != NULL);
+
+    if (comparar == NULL)
+        return fox_memfind_last(vec->items, vec->size, vec->chunksize,
+            needle);
+
+    u8 *iter = vec->items;
+
+    for (usize i = vec->size; i-- > 0;) {
+        if (comparar(iter + i * vec->chunksize, needle))
+            return i;
+    }
+
+    return -1;
+}
+
+usize fox_vec_count(const struct fox_vec *vec, const void *needle,
+    comparar *comparar)
+{
+    assert(vec != NULL);
+
+    if (comparar == NULL)
+        return fox_memcount(vec->items, vec->size, vec->chunksize, needle);
+
+    u8 *iter = vec->items;
+    usize count = 0;
+
+    for (usize i = 0; i < vec->size; i++) {
+        count += comparar(iter, needle);
+        iter += vec->chunksize;
+    }
+
+    return count;
+}
+
+/*
+ * Branchless: the loop always runs log2(size) times and picks the next half
+ * with a conditional move, so the only cache misses are the probes, and both
+ * possible next probes are prefetched while the current one is compared.
+ */
+usize fox_vec_lower_bound(const struct fox_vec *vec, const void *needle,
+    comparar *comparar)
+{
+    assert(vec != NULL);
+
+    struct _sorter s = { vec->chunksize, comparar };
+    const u8 *base = vec->items;
+    usize n = vec->size, size = vec->chunksize;
+
+    if (n == 0)
+        return 0;
+
+    while (n > 1) {
+        usize half = n / 2;
+
+        __builtin_prefetch(base + (n - half) / 2 * size);
+        __builtin_prefetch(base + (half + (n - half) / 2) * size);
+
+        base = _less(&s, base + half * size, needle) ? base + half * size :
+            base;
+        n -= half;
+    }
+
+    return (base - (const u8*) vec->items) / size + _less(&s, base, needle);
+}
+
+isize fox_vec_bsearch(const struct fox_vec *vec, const void *needle,
+    comparar *comparar)
+{
+    struct _sorter s = { vec->chunksize, comparar };
+    usize at = fox_vec_lower_bound(vec, needle, comparar);
+
+    if (at == vec->size ||
+        _less(&s, needle, (const u8*) vec->items + at * vec->chunksize))
+        return -1;
+
+    return at;
+}
+
 void fox_vec_swap(struct fox_vec *vec, struct fox_vec *vec2)
 {
     struct fox_vec tmp = *vec;
-    *vec = *vec2;
-    *vec2 = tmp;
+    memcpy(vec, vec2, sizeof(*vec));
+    memcpy(vec2, &tmp, sizeof(*vec2));
+}
+
+/*
+ * Makes room for extra more items with at most one reallocation, doubling
+ * the capacity unless even more is needed. Leaves vec untouched and returns
+ * false when the memory cannot be had.
+ */
+static bool _grow(struct fox_vec *vec, const usize extra)
+{
+    usize cap = fox_allocated(vec->items) / vec->chunksize;
+    usize needed = vec->size + extra;
+
+    assert(cap >= vec->size);
+
+    if (needed < vec->size)
+        return false;
+
+    if (cap >= needed)
+        return true;
+
+    cap = cap > needed / 2 ? cap * 2 : needed;
+    if (cap < 16)
+        cap = 16;
+
+    void *items = fox_reallocarray(vec->items, cap, vec->chunksize);
+    if (items == NULL)
+        return false;
+
+    vec->items = items;
+    return true;
+}
+
+static inline bool _less(const struct _sorter *s, const u8 *a, const u8 *b)
+{
+    if (s->comparar != NULL)
+        return !s->comparar(b, a);
+
+    return fox_memcompare(a, b, s->size) < 0;
+}
+
+/* the common item sizes become register moves */
+static inline void _swap(u8 *a, u8 *b, usize size)
+{
+    u64 x[2], y[2];
+
+    switch (size) {
+    case 4:
+        memcpy(x, a, 4);
+        memcpy(y, b, 4);
+        memcpy(a, y, 4);
+        memcpy(b, x, 4);
+        return;
+    case 8:
+        memcpy(x, a, 8);
+        memcpy(y, b, 8);
+        memcpy(a, y, 8);
+        memcpy(b, x, 8);
+        return;
+    case 16:
+        memcpy(x, a, 16);
+        memcpy(y, b, 16);
+        memcpy(a, y, 16);
+        memcpy(b, x, 16);
+        return;
+    }
+
+    for (; size >= 8; size -= 8, a += 8, b += 8) {
+        memcpy(x, a, 8);
+        memcpy(y, b, 8);
+        memcpy(a, y, 8);
+        memcpy(b, x, 8);
+    }
+
+    for (; size > 0; size--, a++, b++) {
+        u8 t = *a;
+        *a = *b;
+        *b = t;
+    }
+}
+
+static inline void _copy(u8 *dest, const u8 *src, usize size)
+{
+    switch (size) {
+    case 4:
+        memcpy(dest, src, 4);
+        return;
+    case 8:
+        memcpy(dest, src, 8);
+        return;
+    case 16:
+        memcpy(dest, src, 16);
+        return;
+    }
+
+    fox_memcopy(dest, src, size);
+}
+
+static void _insertion_sort(const struct _sorter *s, u8 *lo, usize n)
+{
+    usize size = s->size;
+
+    for (usize i = 1; i < n; i++) {
+        for (u8 *it = lo + i * size; it > lo && _less(s, it, it - size);
+            it -= size)
+            _swap(it, it - size, size);
+    }
+}
+
+/* gives up once more than SORT_PARTIAL items had to move */
+static bool _partial_insertion_sort(const struct _sorter *s, u8 *lo, usize n)
+{
+    usize size = s->size, moves = 0;
+
+    for (usize i = 1; i < n; i++) {
+        for (u8 *it = lo + i * size; it > lo && _less(s, it, it - size);
+            it -= size) {
+            if (++moves > SORT_PARTIAL)
+                return false;
+
+            _swap(it, it - size, size);
+        }
+    }
+
+    return true;
+}
+
+static void _sift_down(const struct _sorter *s, u8 *lo, usize root, usize n)
+{
+    usize size = s->size;
+
+    for (;;) {
+        usize child = 2 * root + 1;
+
+        if (child >= n)
+            return;
+
+        if (child + 1 < n && _less(s, lo + child * size,
+            lo + (child + 1) * size))
+            child++;
+
+        if (!_less(s, lo + root * size, lo + child * size))
+            return;
+
+        _swap(lo + root * size, lo + child * size, size);
+        root = child;
+    }
+}
+
+static void _heapsort(const struct _sorter *s, u8 *lo, usize n)
+{
+    for (usize i = n / 2; i-- > 0;)
+        _sift_down(s, lo, i, n);
+
+    for (usize i = n; i-- > 1;) {
+        _swap(lo, lo + i * s->size, s->size);
+        _sift_down(s, lo, 0, i);
+    }
+}
+
+/* leaves the median of the three in b */
+static void _sort3(const struct _sorter *s, u8 *a, u8 *b, u8 *c)
+{
+    if (_less(s, b, a))
+        _swap(a, b, s->size);
+    if (_less(s, c, b))
+        _swap(b, c, s->size);
+    if (_less(s, b, a))
+        _swap(a, b, s->size);
+}
+
+/* moves the pivot to lo */
+static void _choose_pivot(const struct _sorter *s, u8 *lo, usize n)
+{
+    usize size = s->size;
+    u8 *mid = lo + n / 2 * size, *last = lo + (n - 1) * size;
+
+    if (n > SORT_NINTHER) {
+        _sort3(s, lo, mid, last);
+        _sort3(s, lo + size, mid - size, last - size);
+        _sort3(s, lo + 2 * size, mid + size, last - 2 * size);
+        _sort3(s, mid - size, mid, mid + size);
+    } else {
+        _sort3(s, lo, mid, last);
+    }
+
+    _swap(lo, mid, size);
+}
+
+/*
+ * Hoare partition around the item at lo, items equal to it stop both scans
+ * so runs of duplicates end up split evenly. Returns where the pivot lands.
+ */
+static usize _partition(const struct _sorter *s, u8 *lo, usize n,
+    bool *swapped)
+{
+    usize size = s->size, i = 1, j = n - 1;
+
+    *swapped = false;
+
+    for (;;) {
+        while (i <= j && _less(s, lo + i * size, lo))
+            i++;
+        while (i <= j && _less(s, lo, lo + j * size))
+            j--;
+
+        if (i >= j)
+            break;
+
+        _swap(lo + i * size, lo + j * size, size);
+        *swapped = true;
+        i++;
+        j--;
+    }
+
+    _swap(lo, lo + j * size, size);
+
+    return j;
+}
+
+/*
+ * Pattern-defeating quicksort: after a partition that needed no swaps the
+ * range is likely sorted already and a bounded insertion sort finishes it,
+ * unbalanced partitions shuffle a few items to break the pattern and fall
+ * back to heapsort once bad of them have been seen.
+ */
+static void _introsort(const struct _sorter *s, u8 *lo, usize n, u32 bad)
+{
+    usize size = s->size;
+
+    while (n > SORT_INSERTION) {
+        _choose_pivot(s, lo, n);
+
+        bool swapped;
+        usize left = _partition(s, lo, n, &swapped);
+        usize right = n - left - 1;
+        u8 *hi = lo + (left + 1) * size;
+
+        if (left < n / 8 || right < n / 8) {
+            if (bad-- == 0) {
+                _heapsort(s, lo, n);
+                return;
+            }
+
+            if (left >= SORT_INSERTION) {
+                _swap(lo, lo + left / 4 * size, size);
+                _swap(lo + (left - 1) * size, lo + (left - left / 4) * size,
+                    size);
+            }
+
+            if (right >= SORT_INSERTION) {
+                _swap(hi, hi + right / 4 * size, size);
+                _swap(hi + (right - 1) * size,
+                    hi + (right - right / 4) * size, size);
+            }
+        } else if (!swapped && _partial_insertion_sort(s, lo, left) &&
+            _partial_insertion_sort(s, hi, right)) {
+            return;
+        }
+
+        /* recurse into the smaller side so the stack stays logarithmic */
+        if (left < right) {
+            _introsort(s, lo, left, bad);
+            lo = hi;
+            n = right;
+        } else {
+            _introsort(s, hi, right, bad);
+            n = left;
+        }
+    }
+
+    _insertion_sort(s, lo, n);
+}
+
+/* tmp holds n / 2 items, only the left half is copied out to merge */
+static void _merge_sort(const struct _sorter *s, u8 *lo, usize n, u8 *tmp)
+{
+    usize size = s->size, half = n / 2;
+
+    if (n <= SORT_RUN) {
+        _insertion_sort(s, lo, n);
+        return;
+    }
+
+    u8 *mid = lo + half * size, *end = lo + n * size;
+
+    _merge_sort(s, lo, half, tmp);
+    _merge_sort(s, mid, n - half, tmp);
+
+    if (!_less(s, mid, mid - size))
+        return;
+
+    fox_memcopy(tmp, lo, half * size);
+
+    u8 *a = tmp, *a_end = tmp + half * size, *b = mid, *out = lo;
+
+    while (a < a_end && b < end) {
+        if (_less(s, b, a)) {
+            _copy(out, b, size);
+            b += size;
+        } else {
+            _copy(out, a, size);
+            a += size;
+        }
+
+        out += size;
+    }
+
+    /* whatever is left of the right half is in place already */
+    fox_memcopy(out, a, a_end - a);
+}
+
+static void _insertion_sort_by_key(u8 *lo, usize n, usize size,
+    keyof *keyof)
+{
+    for (usize i = 1; i < n; i++) {
+        for (u8 *it = lo + i * size; it > lo && keyof(it) < keyof(it - size);
+            it -= size)
+            _swap(it, it - size, size);
+    }
+}
+
+/* swaps two distinct byte ranges a word at a time */
+static void _swap_bytes(u8 *a, u8 *b, usize n)
+{
+    u64 x[4], y[4];
+
+    for (; n >= sizeof(x); n -= sizeof(x), a += sizeof(x), b += sizeof(x)) {
+        memcpy(x, a, sizeof(x));
+        memcpy(y, b, sizeof(y));
+        memcpy(a, y, sizeof(y));
+        memcpy(b, x, sizeof(x));
+    }
+
+    for (; n >= 8; n -= 8, a += 8, b += 8) {
+        memcpy(x, a, 8);
+        memcpy(y, b, 8);
+        memcpy(a, y, 8);
+        memcpy(b, x, 8);
+    }
+
+    for (; n > 0; n--, a++, b++) {
+        u8 t = *a;
+        *a = *b;
+        *b = t;
+    }
+}
+
+/*
+ * Gries-Mills block swap, turns [left][right] into [right][left] in place.
+ * Each step swaps the shorter block into its final position as plain memory,
+ * item boundaries do not matter. Once the shorter block fits in a small
+ * fixed buffer one fox_memmove finishes the job, many tiny swaps would not.
+ */
+static void _rotate(u8 *p, usize left, usize right)
+{
+    u8 buffer[ROTATE_BUFFER];
+
+    while (left > 0 && right > 0) {
+        if (left <= sizeof(buffer)) {
+            fox_memcopy(buffer, p, left);
+            fox_memmove(p, p + left, right);
+            fox_memcopy(p + right, buffer, left);
+            return;
+        }
+
+        if (right <= sizeof(buffer)) {
+            fox_memcopy(buffer, p + left, right);
+            fox_memmove(p + right, p, left);
+            fox_memcopy(p, buffer, right);
+            return;
+        }
+
+        if (left <= right) {
+            _swap_bytes(p, p + left, left);
+            p += left;
+            right -= left;
+        } else {
+            _swap_bytes(p + left - right, p + left, right);
+            left -= right;
+        }
+    }
 }
@@ -1,5 +1,7 @@
 #include <alloc.h>
 
+#include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 
 int main() {
@@ -8,5 +10,17 @@ int main() {
     int *ptr = fox_alloc(sizeof(int));
 
     printf("%X\n", *ptr);
+
+    u8 *aligned = fox_alloc_aligned(100, 64);
+    assert((uintptr_t) aligned % 64 == 0);
+    assert(fox_allocated(aligned) == 100);
+
+    aligned[99] = 1;
+    aligned = fox_realloc(aligned, 5000);
+    assert((uintptr_t) aligned % 64 == 0);
+    assert(aligned[99] == 1);
+    assert(fox_check(aligned));
+
+    fox_free(aligned);
     return 0;
 }
@@ -0,0 +1,51 @@
+#include <assert.h>
+
+#include <alloc.h>
+#include <arena.h>
+#include <vec.h>
+
+int main()
+{
+    fox_alloc_options = "CF";
+
+    struct fox_arena *arena = fox_arena_new(4096);
+    int *a = fox_arena_alloc(arena, sizeof(int));
+    *a = 1;
+
+    assert(fox_allocated(a) == sizeof(int));
+    assert(fox_check(a));
+
+    struct fox_arena_mark mark = fox_arena_save(arena);
+
+    char *big = fox_arena_alloczero(arena, 1000);
+    assert(big[999] == 0);
+
+    /* the last allocation grows in place */
+    char *grown = fox_realloc(big, 1500);
+    assert(grown == big);
+
+    /* too big for the block, spills into a new one */
+    char *huge = fox_arena_alloc(arena, 8192);
+    assert(fox_allocated(huge) == 8192);
+
+    fox_arena_restore(arena, mark);
+    int *b = fox_arena_alloc(arena, sizeof(int));
+    *b = 2;
+    assert(*a == 1);
+
+    struct fox_vec vec = fox_vec_new_in(arena, sizeof(int));
+    for (int i = 0; i < 100; i++) {
+        fox_vec_reserve(&vec, vec.size + 1);
+        fox_vec_push(&vec, &i);
+    }
+
+    assert(*(int*) fox_vec_get(&vec, 99) == 99);
+    fox_vec_del(&vec, NULL);
+
+    fox_arena_reset(arena);
+    int *c = fox_arena_alloc(arena, sizeof(int));
+    assert(c == a);
+
+    fox_arena_del(arena);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include <assert.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <alloc.h>
+
+#include "../src/alloc_private.h"
+
+/* options are read once per process, each case runs in a child */
+static int run(const char *options, void (*test)())
+{
+    pid_t pid = fork();
+    int status;
+
+    if (pid == 0) {
+        fox_alloc_options = options;
+        test();
+        _exit(0);
+    }
+
+    assert(waitpid(pid, &status, 0) == pid);
+    return status;
+}
+
+static void sizes_default()
+{
+    u8 *p = fox_alloc(10);
+    assert(_fox_canary_size() == 100);
+    p[10 + 99] = 1;
+    assert(!fox_check(p));
+    p[10 + 99] = 0;
+    fox_free(p);
+}
+
+static void sizes_32()
+{
+    u8 *p = fox_alloc(10);
+    assert(_fox_canary_size() == 32);
+    assert(fox_check(p));
+    p[10 + 31] = 1;
+    assert(!fox_check(p));
+    p[10 + 31] = 0;
+    assert(fox_check(p));
+    fox_free(p);
+}
+
+static void sizes_0()
+{
+    u8 *p = fox_alloc(10);
+    assert(_fox_canary_size() == 0 && fox_check(p));
+    fox_free(p);
+}
+
+/* C- leaves a smashed canary to fox_check_all instead of aborting */
+static void lazy()
+{
+    u8 *p = fox_alloc(10), *q = fox_alloc(20);
+    assert(fox_check_all());
+
+    q[20] = 1;
+    assert(!fox_check_all());
+    fox_free(q);
+    assert(fox_check_all());
+    fox_free(p);
+}
+
+static void eager()
+{
+    u8 *p = fox_alloc(10);
+    p[10] = 1;
+    fox_free(p);
+}
+
+int main()
+{
+    assert(run("C", sizes_default) == 0);
+    assert(run("C32", sizes_32) == 0);
+    assert(run("C0", sizes_0) == 0);
+    assert(run("C32-F", lazy) == 0);
+
+    int status = run("CQ", eager);
+    assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+
+    printf("canary: ok\n");
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include <deque.h>
+#include <num.h>
+
+static int deleted = 0;
+
+void count(void *data)
+{
+    (void) data;
+    deleted++;
+}
+
+int main()
+{
+    struct fox_deque dq = fox_deque_new(sizeof(int));
+    int val;
+
+    assert(fox_deque_is_empty(&dq) && fox_deque_front(&dq) == NULL);
+
+    val = 1;
+    fox_deque_push_back(&dq, &val); /* [1] */
+    val = 0;
+    fox_deque_push_front(&dq, &val); /* [0, 1] */
+    val = 2;
+    fox_deque_push_back(&dq, &val); /* [0, 1, 2] */
+
+    assert(dq.size == 3);
+    assert(*(int*) fox_deque_front(&dq) == 0);
+    assert(*(int*) fox_deque_back(&dq) == 2);
+    assert(*(int*) fox_deque_get(&dq, 1) == 1);
+    assert(fox_deque_get(&dq, 3) == NULL);
+
+    fox_deque_pop_front(&dq, NULL); /* [1, 2] */
+    fox_deque_pop_back(&dq, NULL); /* [1] */
+    assert(dq.size == 1 && *(int*) fox_deque_front(&dq) == 1);
+    fox_deque_pop_front(&dq, NULL);
+    fox_deque_pop_front(&dq, NULL);
+    assert(fox_deque_is_empty(&dq));
+
+    /* a queue going round the ring, then growing while wrapped */
+    for (int round = 0; round < 100; round++) {
+        val = round;
+        fox_deque_push_back(&dq, &val);
+        if (round % 3 != 2)
+            fox_deque_pop_front(&dq, NULL);
+    }
+    assert(dq.size == 33);
+    for (usize i = 0; i < dq.size; i++)
+        assert(*(int*) fox_deque_get(&dq, i) == (int) i + 67);
+
+    fox_deque_clear(&dq, NULL);
+
+    /* both ends at once, front grows down and back grows up */
+    for (int i = 0; i < 1000; i++) {
+        val = i;
+        fox_deque_push_back(&dq, &val);
+        val = -i - 1;
+        fox_deque_push_front(&dq, &val);
+    }
+    assert(dq.size == 2000);
+    assert((dq.capacity & (dq.capacity - 1)) == 0);
+    for (usize i = 0; i < dq.size; i++)
+        assert(*(int*) fox_deque_get(&dq, i) == (int) i - 1000);
+
+    /* growing moves the front piece here, and the wrapped start after */
+    fox_deque_clear(&dq, NULL);
+    fox_deque_reserve(&dq, 16);
+    usize cap = dq.capacity;
+    for (usize i = 0; i < cap; i++) {
+        val = (int) i;
+        if (i < cap / 4)
+            fox_deque_push_front(&dq, &val);
+        else
+            fox_deque_push_back(&dq, &val);
+    }
+    val = -1;
+    fox_deque_push_back(&dq, &val);
+    assert(dq.capacity == cap * 2);
+    for (usize i = 0; i < cap / 4; i++)
+        assert(*(int*) fox_deque_get(&dq, i) == (int) (cap / 4 - 1 - i));
+    for (usize i = cap / 4; i < cap; i++)
+        assert(*(int*) fox_deque_get(&dq, i) == (int) i);
+    assert(*(int*) fox_deque_back(&dq) == -1);
+
+    fox_deque_clear(&dq, NULL);
+    for (usize i = 0; i < dq.capacity; i++) {
+        val = (int) i;
+        if (i < dq.capacity * 3 / 4)
+            fox_deque_push_front(&dq, &val);
+        else
+            fox_deque_push_back(&dq, &val);
+    }
+    cap = dq.capacity;
+    val = -1;
+    fox_deque_push_front(&dq, &val);
+    assert(*(int*) fox_deque_front(&dq) == -1);
+    for (usize i = 0; i < cap * 3 / 4; i++)
+        assert(*(int*) fox_deque_get(&dq, i + 1) == (int) (cap * 3 / 4 - 1 - i));
+    for (usize i = cap * 3 / 4; i < cap; i++)
+        assert(*(int*) fox_deque_get(&dq, i + 1) == (int) i);
+
+    fox_deque_del(&dq, count);
+    assert(deleted == (int) cap + 1);
+
+    printf("deque: ok\n");
+    return 0;
+}
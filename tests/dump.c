@@ -0,0 +1,148 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <alloc.h>
+#include <dump.h>
+
+struct file {
+    u8 *data;
+    usize size;
+};
+
+/* options are read once per process, each snapshot is taken in a child */
+static void take(const char *options, bool more)
+{
+    pid_t pid = fork();
+    int status;
+
+    if (pid == 0) {
+        fox_alloc_options = options;
+
+        char *untouched = fox_alloc(24), *hello = fox_alloc(5);
+        char *odd = fox_alloc(13);
+        memcpy(hello, "hello", 5);
+        memset(odd, 'x', 13);
+        (void) untouched;
+
+        assert(fox_alloc_snapshot(more ? "dump_old.foxstd" :
+            "dump_content.foxstd"));
+        if (more) {
+            fox_alloc(5);
+            fox_alloc(5);
+            assert(fox_alloc_snapshot("dump_new.foxstd"));
+        }
+        _exit(0);
+    }
+
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+        WEXITSTATUS(status) == 0);
+}
+
+static struct file slurp(const char *path)
+{
+    struct file f = {0};
+    FILE *in = fopen(path, "rb");
+
+    assert(in != NULL);
+    fseek(in, 0, SEEK_END);
+    f.size = ftell(in);
+    rewind(in);
+    f.data = malloc(f.size);
+    assert(fread(f.data, 1, f.size, in) == f.size);
+    fclose(in);
+
+    return f;
+}
+
+static void check(const char *path, bool content)
+{
+    struct file f = slurp(path);
+    struct fox_dump_header *h = (void*) f.data;
+
+    assert(memcmp(h->magic, FOX_DUMP_MAGIC, sizeof(FOX_DUMP_MAGIC)) == 0);
+    assert(h->version == FOX_DUMP_VERSION);
+    assert(h->flags == (content ? FOX_DUMP_CONTENT : 0));
+    assert(h->count == 3 && h->index % 8 == 0);
+    assert(h->index + 3 * sizeof(struct fox_dump_entry) == f.size);
+
+    struct fox_dump_entry *e = (void*) (f.data + h->index);
+    usize bytes = 0, screaming = 0;
+
+    for (usize i = 0; i < 3; i++) {
+        assert(i == 0 || e[i - 1].address < e[i].address);
+        bytes += e[i].size;
+        screaming += e[i].screaming;
+
+        if (!content) {
+            assert(e[i].offset == 0);
+            continue;
+        }
+
+        const u8 *data = f.data + e[i].offset;
+        assert(e[i].offset + e[i].size <= h->index);
+        if (e[i].size == 5)
+            assert(memcmp(data, "hello", 5) == 0);
+        if (e[i].size == 13)
+            assert(data[0] == 'x' && data[12] == 'x');
+        if (e[i].size == 24)
+            assert(data[0] == 0xAA && data[23] == 0xAA);
+    }
+    assert(bytes == 42 && screaming == 1);
+
+    free(f.data);
+}
+
+/* runs foxdump from next to this binary, true when output has every line */
+static bool foxdump(const char *dir, const char *args, const char **lines)
+{
+    char command[512], out[4096];
+    usize n;
+
+    snprintf(command, sizeof(command), "%s/foxdump %s", dir, args);
+    FILE *p = popen(command, "r");
+    assert(p != NULL);
+    n = fread(out, 1, sizeof(out) - 1, p);
+    out[n] = 0;
+
+    if (pclose(p) != 0)
+        return false;
+
+    for (; *lines != NULL; lines++)
+        if (strstr(out, *lines) == NULL)
+            return false;
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    (void) argc;
+    char *dir = dirname(argv[0]);
+
+    take("D+", false);
+    take("D", true);
+
+    check("dump_content.foxstd", true);
+    check("dump_old.foxstd", false);
+
+    const char *summary[] = { "blocks:    3", "bytes:     42",
+        "untouched: 1", "contents:  yes", NULL };
+    assert(foxdump(dir, "dump_content.foxstd", summary));
+
+    const char *growth[] = { "new blocks: 2 (10 bytes)", "+2", NULL };
+    assert(foxdump(dir, "dump_old.foxstd dump_new.foxstd", growth));
+
+    remove("dump_content.foxstd");
+    remove("dump_old.foxstd");
+    remove("dump_new.foxstd");
+
+    printf("dump: ok\n");
+    return 0;
+}
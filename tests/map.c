@@ -0,0 +1,110 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <map.h>
+#include <num.h>
+
+#define N 10000
+
+struct name {
+    char text[12];
+};
+
+u64 by_length(const void *key)
+{
+    return strlen(((const struct name*) key)->text);
+}
+
+bool same_text(const void *a, const void *b)
+{
+    return strcmp(((const struct name*) a)->text,
+        ((const struct name*) b)->text) == 0;
+}
+
+int main()
+{
+    struct fox_map map = fox_map_new(sizeof(u32), sizeof(u64), NULL, NULL);
+    u32 key;
+    u64 value;
+
+    assert(fox_map_get(&map, &key) == NULL);
+
+    for (key = 0; key < N; key++) {
+        value = (u64) key * 3;
+        assert(fox_map_insert(&map, &key, &value) != NULL);
+    }
+    assert(map.size == N);
+    assert((map.capacity & (map.capacity - 1)) == 0);
+
+    key = 78;
+    value = 1;
+    fox_map_insert(&map, &key, &value);
+    assert(map.size == N && *(u64*) fox_map_get(&map, &key) == 1);
+
+    /* remove every other key, their slots are reused afterwards */
+    for (key = 0; key < N; key += 2) {
+        assert(fox_map_remove(&map, &key, &value));
+        assert(value == (key == 78 ? 1 : (u64) key * 3));
+    }
+    assert(map.size == N / 2);
+    key = 4;
+    assert(!fox_map_contains(&map, &key) && !fox_map_remove(&map, &key, NULL));
+
+    usize capacity = map.capacity;
+    for (usize round = 0; round < 20; round++) {
+        for (key = 0; key < N; key += 2)
+            fox_map_insert(&map, &key, NULL);
+        for (key = 0; key < N; key += 2)
+            fox_map_remove(&map, &key, NULL);
+    }
+    assert(map.capacity == capacity && map.size == N / 2);
+
+    usize seen = 0;
+    u64 sum = 0;
+    void *k, *v;
+    for (usize it = 0; fox_map_next(&map, &it, &k, &v);) {
+        assert(*(u32*) k % 2 == 1);
+        sum += *(u64*) v;
+        seen++;
+    }
+    assert(seen == N / 2 && sum == 3ull * (N / 2) * (N / 2));
+
+    fox_map_clear(&map);
+    assert(map.size == 0 && fox_map_get(&map, &key) == NULL);
+    fox_map_del(&map, NULL, NULL);
+
+    /* a bad hash still works, every key lands in one of a few groups */
+    struct fox_map names = fox_map_new(sizeof(struct name), sizeof(int),
+        by_length, same_text);
+    struct name name = {{0}};
+
+    assert(fox_map_reserve(&names, 1000));
+    capacity = names.capacity;
+    for (int i = 0; i < 1000; i++) {
+        snprintf(name.text, sizeof(name.text), "n%d", i);
+        fox_map_insert(&names, &name, &i);
+    }
+    assert(names.capacity == capacity);
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(name.text, sizeof(name.text), "n%d", i);
+        assert(*(int*) fox_map_get(&names, &name) == i);
+    }
+
+    /* removing from the long run of full groups moves later keys back */
+    for (int i = 0; i < 1000; i += 3) {
+        snprintf(name.text, sizeof(name.text), "n%d", i);
+        assert(fox_map_remove(&names, &name, NULL));
+    }
+    for (int i = 0; i < 1000; i++) {
+        snprintf(name.text, sizeof(name.text), "n%d", i);
+        int *found = fox_map_get(&names, &name);
+        assert(i % 3 == 0 ? found == NULL : *found == i);
+    }
+    assert(names.size == 666);
+    fox_map_del(&names, NULL, NULL);
+
+    printf("map: ok\n");
+    return 0;
+}
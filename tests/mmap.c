@@ -0,0 +1,60 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <alloc.h>
+#include <vec.h>
+
+#include "../src/alloc_private.h"
+
+static usize kind(void *p)
+{
+    return fox_tag_kind(fox_tag(fox_visualize(p)));
+}
+
+int main()
+{
+    fox_alloc_options = "CFM65536";
+
+    /* below the threshold blocks stay on the heap, past it they are mapped */
+    usize size = 4096;
+    u8 *big = fox_alloc(size);
+    memset(big, 0xAB, size);
+    assert(kind(big) == FOX_HEAP);
+
+    for (int i = 0; i < 8; i++) {
+        big = fox_realloc(big, size * 2);
+        memset(big + size, 0xAB, size);
+        size *= 2;
+        assert(fox_allocated(big) == size);
+        assert(fox_check(big));
+    }
+    assert(kind(big) == FOX_MMAP);
+    assert(big[0] == 0xAB && big[size - 1] == 0xAB);
+
+    /* shrinking keeps the mapping */
+    big = fox_realloc(big, 100);
+    assert(kind(big) == FOX_MMAP);
+    assert(fox_allocated(big) == 100 && big[99] == 0xAB);
+    assert(fox_check_all());
+    fox_free(big);
+
+    u8 *aligned = fox_alloc_aligned(1 << 20, 4096);
+    assert(kind(aligned) == FOX_MMAP && (uintptr_t) aligned % 4096 == 0);
+    aligned = fox_realloc(aligned, 1 << 21);
+    assert((uintptr_t) aligned % 4096 == 0);
+    assert(fox_check(aligned));
+    fox_freezero(aligned);
+
+    /* a doubling vector ends up remapped instead of copied */
+    struct fox_vec vec = fox_vec_new(sizeof(u32));
+    for (u32 i = 0; i < (1 << 20); i++)
+        fox_vec_push(&vec, &i);
+    assert(kind(vec.items) == FOX_MMAP);
+    assert(((u32*) vec.items)[(1 << 20) - 1] == (1 << 20) - 1);
+    fox_vec_del(&vec, NULL);
+
+    printf("mmap: ok\n");
+    return 0;
+}
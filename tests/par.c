@@ -0,0 +1,103 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <alloc.h>
+#include <par.h>
+#include <vec.h>
+#include <num.h>
+
+#define N 200000
+
+struct pair {
+    u32 key;
+    u32 order;
+};
+
+bool by_key(const void *a, const void *b)
+{
+    return ((const struct pair*) a)->key <= ((const struct pair*) b)->key;
+}
+
+bool same_key(const void *a, const void *b)
+{
+    return ((const struct pair*) a)->key == ((const struct pair*) b)->key;
+}
+
+void bump(void *data, void *ctx)
+{
+    ((struct pair*) data)->order++;
+    __atomic_fetch_add((usize*) ctx, 1, __ATOMIC_RELAXED);
+}
+
+void add(void *acc, const void *data)
+{
+    *(double*) acc += 1.0 / (1 + ((const struct pair*) data)->key);
+}
+
+void merge(void *acc, const void *data)
+{
+    *(double*) acc += *(const double*) data;
+}
+
+double sum(struct fox_vec *vec)
+{
+    double result = 0.0;
+    fox_vec_par_reduce(vec, &result, sizeof(result), add, merge);
+    return result;
+}
+
+int main()
+{
+    struct fox_vec vec = fox_vec_new(sizeof(struct pair));
+    struct pair *items = fox_vec_append_uninit(&vec, N);
+    usize visited = 0;
+
+    srand(7);
+    for (usize i = 0; i < N; i++) {
+        items[i].key = rand() % 1000;
+        items[i].order = i;
+    }
+
+    fox_par_threads(4);
+    assert(fox_par_thread_count() == 4);
+
+    fox_vec_par_for_each(&vec, bump, &visited);
+    assert(visited == N);
+    for (usize i = 0; i < N; i++)
+        assert(items[i].order == i + 1);
+
+    /* same bits on any number of threads */
+    double four = sum(&vec);
+    fox_par_threads(1);
+    assert(sum(&vec) == four);
+    fox_par_threads(3);
+    assert(sum(&vec) == four);
+
+    struct pair needle = { 1000, 0 };
+    assert(fox_vec_par_find(&vec, &needle, same_key) == -1);
+    items[N - 5].key = 1000;
+    items[N / 2].key = 1000;
+    assert(fox_vec_par_find(&vec, &needle, same_key) == N / 2);
+    assert(fox_vec_par_find(&vec, &items[N - 5], NULL) == N - 5);
+    items[N - 5].key = items[N / 2].key = 999;
+
+    fox_vec_par_sort(&vec, by_key);
+    items = vec.items;
+    for (usize i = 1; i < N; i++) {
+        assert(items[i - 1].key <= items[i].key);
+        if (items[i - 1].key == items[i].key)
+            assert(items[i - 1].order < items[i].order);
+    }
+
+    struct fox_vec small = fox_vec_new(sizeof(struct pair));
+    fox_vec_par_sort(&small, by_key);
+    assert(fox_vec_par_find(&small, &needle, NULL) == -1);
+    fox_vec_del(&small, NULL);
+
+    fox_vec_del(&vec, NULL);
+    fox_par_threads(0);
+
+    printf("par: ok\n");
+    return 0;
+}
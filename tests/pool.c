@@ -0,0 +1,85 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#include <pool.h>
+#include <num.h>
+
+struct fib {
+    struct fox_pool *pool;
+    u32 n;
+    u64 result;
+};
+
+/* forks down to the leaves, every level waits for the half it spawned */
+void fib(void *ctx)
+{
+    struct fib *f = ctx;
+
+    if (f->n < 2) {
+        f->result = f->n;
+        return;
+    }
+
+    struct fib a = { f->pool, f->n - 1, 0 }, b = { f->pool, f->n - 2, 0 };
+    struct fox_task *task = fox_pool_spawn(f->pool, fib, &a);
+
+    fib(&b);
+    fox_pool_wait(f->pool, task);
+    f->result = a.result + b.result;
+}
+
+void count(void *ctx)
+{
+    __atomic_fetch_add((usize*) ctx, 1, __ATOMIC_RELAXED);
+}
+
+/* spawns from a thread outside the pool */
+void *outside(void *arg)
+{
+    struct fib f = { arg, 20, 0 };
+    struct fox_task *task = fox_pool_spawn(f.pool, fib, &f);
+
+    fox_pool_wait(f.pool, task);
+    assert(f.result == 6765);
+    return NULL;
+}
+
+int main()
+{
+    struct fox_pool *pool = fox_pool_new(4);
+    assert(pool != NULL && fox_pool_threads(pool) == 4);
+
+    struct fib f = { pool, 25, 0 };
+    fox_pool_wait(pool, fox_pool_spawn(pool, fib, &f));
+    assert(f.result == 75025);
+
+    /* more tasks than a deque starts with, waited for out of order */
+    struct fox_task *tasks[1000];
+    usize counted = 0;
+
+    for (usize i = 0; i < 1000; i++)
+        tasks[i] = fox_pool_spawn(pool, count, &counted);
+    for (usize i = 1000; i-- > 0;)
+        fox_pool_wait(pool, tasks[i]);
+    assert(counted == 1000);
+
+    pthread_t threads[3];
+    for (usize i = 0; i < 3; i++)
+        pthread_create(threads + i, NULL, outside, pool);
+    for (usize i = 0; i < 3; i++)
+        pthread_join(threads[i], NULL);
+
+    fox_pool_wait(pool, NULL);
+    fox_pool_del(pool);
+
+    pool = fox_pool_new(1);
+    f.pool = pool;
+    f.n = 15;
+    fox_pool_wait(pool, fox_pool_spawn(pool, fib, &f));
+    assert(f.result == 610);
+    fox_pool_del(pool);
+
+    printf("pool: ok\n");
+    return 0;
+}
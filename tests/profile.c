@@ -0,0 +1,72 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include <alloc.h>
+#include <arena.h>
+
+struct totals {
+    usize live_count, live_bytes;
+    usize total_count, total_bytes;
+};
+
+static struct totals profile()
+{
+    struct totals t = {0};
+    FILE *in;
+
+    assert(fox_alloc_profile("profile.foxstd"));
+    assert((in = fopen("profile.foxstd", "r")) != NULL);
+    assert(fscanf(in, "heap profile: %zu: %zu [%zu: %zu]", &t.live_count,
+        &t.live_bytes, &t.total_count, &t.total_bytes) == 4);
+    fclose(in);
+    remove("profile.foxstd");
+
+    return t;
+}
+
+int main()
+{
+    fox_alloc_options = "P0Q";
+
+    /* P0 samples every allocation, the first one included */
+    char *p = fox_alloc(100);
+    struct totals t = profile();
+    assert(t.live_count == 1 && t.live_bytes == 100);
+    assert(t.total_count == 1 && t.total_bytes == 100);
+
+    p = fox_realloc(p, 300);
+    t = profile();
+    assert(t.live_count == 1 && t.live_bytes == 300);
+    assert(t.total_count == 2 && t.total_bytes == 400);
+
+    fox_free(p);
+    t = profile();
+    assert(t.live_count == 0 && t.live_bytes == 0);
+    assert(t.total_count == 2 && t.total_bytes == 400);
+
+    /* arena objects leave the profile on reset and on del */
+    struct fox_arena *arena = fox_arena_new(4096);
+    struct totals before = profile();
+
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 100; i++)
+            fox_arena_alloc(arena, 64);
+        fox_arena_reset(arena);
+    }
+
+    t = profile();
+    assert(t.live_count == before.live_count);
+    assert(t.live_bytes == before.live_bytes);
+    assert(t.total_count >= before.total_count + 999);
+
+    for (int i = 0; i < 100; i++)
+        fox_arena_alloc(arena, 64);
+    fox_arena_del(arena);
+
+    t = profile();
+    assert(t.live_count == before.live_count);
+    assert(t.live_bytes == before.live_bytes);
+
+    printf("profile: ok\n");
+    return 0;
+}
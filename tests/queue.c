@@ -0,0 +1,197 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#include <queue.h>
+#include <num.h>
+
+#define N 200000
+#define PRODUCERS 3
+#define CONSUMERS 2
+
+static int deleted = 0;
+
+void count(void *data)
+{
+    (void) data;
+    deleted++;
+}
+
+struct job {
+    u32 producer;
+    u32 seq;
+};
+
+static struct fox_spsc *spsc;
+static struct fox_mpmc *mpmc;
+static u64 consumed[CONSUMERS];
+
+void *spsc_producer(void *arg)
+{
+    (void) arg;
+
+    for (u32 i = 0; i < N;) {
+        u32 batch[7];
+        usize n = 0;
+
+        /* singles and batches, blocking and not */
+        if (i % 3 == 0) {
+            fox_spsc_push(spsc, &i);
+            i++;
+            continue;
+        }
+
+        while (n < 7 && i + n < N) {
+            batch[n] = i + n;
+            n++;
+        }
+        if (i % 3 == 1) {
+            fox_spsc_push_n(spsc, batch, n);
+        } else {
+            while (!fox_spsc_try_push(spsc, batch))
+                ;
+            fox_spsc_push_n(spsc, batch + 1, n - 1);
+        }
+        i += n;
+    }
+
+    return NULL;
+}
+
+void *mpmc_producer(void *arg)
+{
+    struct job jobs[4];
+    u32 id = (u32) (usize) arg;
+
+    for (u32 i = 0; i < N; i += 4) {
+        for (u32 k = 0; k < 4; k++)
+            jobs[k] = (struct job) { id, i + k };
+        if (i % 8 == 0)
+            fox_mpmc_push_n(mpmc, jobs, 4);
+        else
+            for (u32 k = 0; k < 4; k++)
+                fox_mpmc_push(mpmc, jobs + k);
+    }
+
+    return NULL;
+}
+
+void *mpmc_consumer(void *arg)
+{
+    usize id = (usize) arg;
+    u32 last[PRODUCERS] = {0};
+    bool seen[PRODUCERS] = {0};
+    struct job jobs[5];
+
+    for (;;) {
+        usize n = fox_mpmc_try_pop_n(mpmc, jobs, 5);
+
+        if (n == 0) {
+            fox_mpmc_pop(mpmc, jobs);
+            n = 1;
+        }
+
+        for (usize k = 0; k < n; k++) {
+            struct job *j = jobs + k;
+
+            /* hand any other stop job in the batch to the next one */
+            if (j->producer == PRODUCERS) {
+                if (k + 1 < n)
+                    fox_mpmc_push_n(mpmc, j + 1, n - k - 1);
+                return NULL;
+            }
+
+            /* one producer's jobs reach each consumer in order */
+            assert(!seen[j->producer] || j->seq > last[j->producer]);
+            seen[j->producer] = true;
+            last[j->producer] = j->seq;
+            consumed[id] += j->seq + 1;
+        }
+    }
+}
+
+int main()
+{
+    u32 val, out[8];
+
+    spsc = fox_spsc_new(sizeof(u32), 5);
+    assert(spsc != NULL && fox_spsc_capacity(spsc) == 8);
+    assert(!fox_spsc_try_pop(spsc, &val));
+
+    for (val = 0; val < 6; val++)
+        assert(fox_spsc_try_push(spsc, &val));
+    assert(fox_spsc_try_pop_n(spsc, out, 4) == 4 && out[3] == 3);
+
+    /* wraps around the end of the ring */
+    u32 more[6] = { 6, 7, 8, 9, 10, 11 };
+    assert(fox_spsc_try_push_n(spsc, more, 6) == 6);
+    assert(!fox_spsc_try_push(spsc, &val));
+    assert(fox_spsc_try_pop_n(spsc, out, 8) == 8);
+    for (u32 i = 0; i < 8; i++)
+        assert(out[i] == i + 4);
+
+    /* one producer, one consumer, everything arrives in order */
+    pthread_t producer;
+    pthread_create(&producer, NULL, spsc_producer, NULL);
+    for (u32 i = 0; i < N;) {
+        usize n = i % 2 ? fox_spsc_try_pop_n(spsc, out, 8) : 0;
+
+        if (n == 0) {
+            fox_spsc_pop(spsc, out);
+            n = 1;
+        }
+        for (usize k = 0; k < n; k++, i++)
+            assert(out[k] == i);
+    }
+    pthread_join(producer, NULL);
+
+    fox_spsc_try_push(spsc, &val);
+    fox_spsc_try_push(spsc, &val);
+    fox_spsc_del(spsc, count);
+    assert(deleted == 2);
+
+    struct job job;
+
+    mpmc = fox_mpmc_new(sizeof(struct job), 16);
+    assert(mpmc != NULL && fox_mpmc_capacity(mpmc) == 16);
+    assert(!fox_mpmc_try_pop(mpmc, &job));
+    for (u32 i = 0; i < 16; i++) {
+        job = (struct job) { 0, i };
+        assert(fox_mpmc_try_push(mpmc, &job));
+    }
+    assert(!fox_mpmc_try_push(mpmc, &job));
+
+    struct job jobs[16];
+    assert(fox_mpmc_try_pop_n(mpmc, jobs, 5) == 5 && jobs[4].seq == 4);
+    assert(fox_mpmc_try_push_n(mpmc, jobs, 16) == 5);
+    assert(fox_mpmc_try_pop_n(mpmc, jobs, 16) == 16);
+    assert(jobs[0].seq == 5 && jobs[11].seq == 0 && jobs[15].seq == 4);
+
+    /* a few of each, every job is taken exactly once */
+    pthread_t producers[PRODUCERS], consumers[CONSUMERS];
+
+    for (usize i = 0; i < CONSUMERS; i++)
+        pthread_create(consumers + i, NULL, mpmc_consumer, (void*) i);
+    for (usize i = 0; i < PRODUCERS; i++)
+        pthread_create(producers + i, NULL, mpmc_producer, (void*) i);
+    for (usize i = 0; i < PRODUCERS; i++)
+        pthread_join(producers[i], NULL);
+
+    job = (struct job) { PRODUCERS, 0 };
+    for (usize i = 0; i < CONSUMERS; i++)
+        fox_mpmc_push(mpmc, &job);
+    for (usize i = 0; i < CONSUMERS; i++)
+        pthread_join(consumers[i], NULL);
+
+    u64 total = 0;
+    for (usize i = 0; i < CONSUMERS; i++)
+        total += consumed[i];
+    assert(total == (u64) PRODUCERS * N * (N + 1) / 2);
+
+    fox_mpmc_try_push(mpmc, &job);
+    fox_mpmc_del(mpmc, count);
+    assert(deleted == 3);
+
+    printf("queue: ok\n");
+    return 0;
+}
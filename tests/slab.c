@@ -0,0 +1,104 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <alloc.h>
+
+#include "../src/alloc_private.h"
+
+static pthread_key_t late_key;
+
+static usize kind(void *p)
+{
+    return fox_tag_kind(fox_tag(fox_visualize(p)));
+}
+
+static void *free_it(void *p)
+{
+    fox_free(p);
+    return NULL;
+}
+
+static void *alloc_it(void *arg)
+{
+    u8 *p = fox_alloc(200);
+    memset(p, *(u8*) arg, 200);
+    return p;
+}
+
+/* runs after the slab destructor, keys are destroyed in creation order */
+static void late_free(void *p)
+{
+    fox_free(p);
+}
+
+static void *keep_until_exit(void *out)
+{
+    void *p = fox_alloc(1000);
+    *(void**) out = p;
+    pthread_setspecific(late_key, p);
+    return NULL;
+}
+
+int main()
+{
+    fox_alloc_options = "S";
+
+    /* class boundaries, every total fits its class and not the one before */
+    assert(_fox_slab_class(1) == 0 && _fox_slab_class(32) == 0);
+    assert(_fox_slab_class(33) == 1);
+    assert(_fox_slab_class(8192) == FOX_SLAB_CLASSES - 1);
+    assert(_fox_slab_class(8193) == -1);
+    for (usize total = 1; total <= FOX_SLAB_MAX; total++) {
+        i32 cls = _fox_slab_class(total);
+        assert(_fox_slab_size(cls) >= total);
+        assert(cls == 0 || _fox_slab_size(cls - 1) < total);
+    }
+
+    /* 16 bytes of header, no canary */
+    void *small = fox_alloc(16), *last = fox_alloc(8192 - 16);
+    void *heap = fox_alloc(8192 - 15);
+    assert(kind(small) == FOX_SLAB && kind(last) == FOX_SLAB);
+    assert(kind(heap) == FOX_HEAP);
+    fox_free(small);
+    fox_free(last);
+    fox_free(heap);
+
+    /* stays in place inside its class of 64, moves across */
+    u8 *p = fox_alloc(40);
+    memset(p, 7, 40);
+    assert(fox_realloc(p, 48) == p && fox_allocated(p) == 48);
+    p = fox_realloc(p, 100);
+    assert(kind(p) == FOX_SLAB && fox_allocated(p) == 100);
+    assert(p[0] == 7 && p[39] == 7);
+    p = fox_realloc(p, 10000);
+    assert(kind(p) == FOX_HEAP && p[39] == 7);
+    fox_free(p);
+
+    /* blocks freed by another thread than the one that took them */
+    pthread_t t;
+    u8 fill = 9;
+    void *other;
+
+    p = fox_alloc(300);
+    assert(pthread_create(&t, NULL, free_it, p) == 0);
+    pthread_join(t, NULL);
+
+    assert(pthread_create(&t, NULL, alloc_it, &fill) == 0);
+    pthread_join(t, &other);
+    assert(((u8*) other)[199] == 9);
+    fox_free(other);
+
+    /*
+     * A free from a destructor after the slab one lands in a cache that is
+     * drained again, so the block goes back to the central list, on top.
+     */
+    assert(pthread_key_create(&late_key, late_free) == 0);
+    assert(pthread_create(&t, NULL, keep_until_exit, &other) == 0);
+    pthread_join(t, NULL);
+    assert(fox_alloc(1000) == other);
+
+    printf("slab: ok\n");
+    return 0;
+}
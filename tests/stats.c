@@ -0,0 +1,62 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#include <alloc.h>
+#include <arena.h>
+
+static void *in_thread(void *arg)
+{
+    (void) arg;
+    fox_free(fox_alloc(3));
+    return NULL;
+}
+
+int main()
+{
+    struct fox_alloc_stats s = fox_alloc_stats();
+    assert(s.allocs == 0 && s.frees == 0 && s.live_bytes == 0);
+
+    /* sizes of 7, 10 and 17 significant bits */
+    void *a = fox_alloc(100), *b = fox_alloc(1000), *c = fox_alloc(100000);
+
+    s = fox_alloc_stats();
+    assert(s.allocs == 3 && s.frees == 0);
+    assert(s.live_bytes == 101100 && s.peak_bytes == 101100);
+    assert(s.histogram[7] == 1 && s.histogram[10] == 1);
+    assert(s.histogram[17] == 1);
+
+    fox_free(c);
+    fox_free(b);
+    s = fox_alloc_stats();
+    assert(s.frees == 2 && s.live_bytes == 100 && s.peak_bytes == 101100);
+
+    /* aligned blocks are always copied, the last arena object grows */
+    void *d = fox_alloc_aligned(64, 64);
+    d = fox_realloc(d, 128);
+
+    struct fox_arena *arena = fox_arena_new(4096);
+    void *e = fox_arena_alloc(arena, 10);
+    assert(fox_realloc(e, 20) == e);
+
+    s = fox_alloc_stats();
+    assert(s.reallocs_moved == 1 && s.reallocs_grown == 1);
+    assert(s.allocs == 5 && s.histogram[4] == 1 && s.histogram[7] == 2);
+    assert(s.live_bytes == 100 + 128 + 20);
+
+    fox_arena_del(arena);
+    fox_free(d);
+    fox_free(a);
+
+    /* counts of threads that are gone are kept */
+    pthread_t t;
+    pthread_create(&t, NULL, in_thread, NULL);
+    pthread_join(t, NULL);
+
+    s = fox_alloc_stats();
+    assert(s.allocs == 6 && s.frees == 6 && s.live_bytes == 0);
+    assert(s.histogram[2] == 1 && s.peak_bytes == 101100);
+
+    printf("stats: ok\n");
+    return 0;
+}
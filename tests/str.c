@@ -0,0 +1,98 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <str.h>
+#include <num.h>
+
+static bool is_inline(const struct fox_str *s)
+{
+    const char *p = fox_str_cstr(s);
+    return p >= (const char*) s && p < (const char*) (s + 1);
+}
+
+int main()
+{
+    struct fox_str s = fox_str_new();
+
+    assert(sizeof(s) == 3 * sizeof(usize));
+    assert(fox_str_size(&s) == 0 && strcmp(fox_str_cstr(&s), "") == 0);
+
+    /* stays in the struct up to FOX_STR_INLINE bytes */
+    for (usize i = 0; i < FOX_STR_INLINE; i++)
+        fox_str_push(&s, 'a' + i);
+    assert(is_inline(&s) && fox_str_size(&s) == FOX_STR_INLINE);
+    assert(strcmp(fox_str_cstr(&s), "abcdefghijklmnopqrstuv") == 0);
+
+    fox_str_push(&s, '!');
+    assert(!is_inline(&s) && fox_str_size(&s) == FOX_STR_INLINE + 1);
+    assert(strcmp(fox_str_cstr(&s), "abcdefghijklmnopqrstuv!") == 0);
+
+    fox_str_truncate(&s, 3);
+    fox_str_appendf(&s, "-%d-%s", 42, "x");
+    assert(strcmp(fox_str_cstr(&s), "abc-42-x") == 0);
+    fox_str_del(&s);
+
+    /* formatting that does not fit the spare room the first time */
+    s = fox_str_from("n=");
+    fox_str_appendf(&s, "%0100d", 7);
+    assert(fox_str_size(&s) == 102 && fox_str_cstr(&s)[101] == '7');
+    fox_str_del(&s);
+
+    /* appending a slice of itself, across the move to the heap */
+    s = fox_str_from("0123456789");
+    fox_str_append_n(&s, fox_str_cstr(&s), 10);
+    fox_str_append_n(&s, fox_str_cstr(&s) + 5, 10);
+    assert(strcmp(fox_str_cstr(&s), "012345678901234567895678901234") == 0);
+    fox_str_del(&s);
+
+    s = fox_str_new();
+    for (int i = 0; i < 1000; i++)
+        fox_str_appendf(&s, "%d,", i);
+    assert(fox_str_capacity(&s) >= fox_str_size(&s));
+    assert(fox_str_reserve(&s, 10000) && fox_str_capacity(&s) >= 10000);
+
+    /* find and split */
+    struct fox_str_view all = fox_str_as_view(&s);
+    assert(fox_str_find(&s, fox_str_view_of("998,999,")) ==
+        (isize) fox_str_size(&s) - 8);
+    assert(fox_str_find(&s, fox_str_view_of("1000")) == -1);
+    assert(fox_str_view_find_char(all, '9') == 18);
+    assert(fox_str_view_find(all, fox_str_view_of("")) == 0);
+
+    struct fox_str_view rest = all, piece;
+    int expect = 0;
+    while (fox_str_view_split(&rest, fox_str_view_of(","), &piece)) {
+        if (expect == 1000) {
+            assert(piece.size == 0);
+        } else {
+            char buf[16];
+            snprintf(buf, sizeof(buf), "%d", expect);
+            assert(fox_str_view_equal(piece, fox_str_view_of(buf)));
+        }
+        expect++;
+    }
+    assert(expect == 1001);
+
+    rest = fox_str_view_of("a::::b");
+    const char *want[] = { "a", "", "b" };
+    for (int i = 0; fox_str_view_split(&rest, fox_str_view_of("::"), &piece);
+        i++)
+        assert(i < 3 && fox_str_view_equal(piece, fox_str_view_of(want[i])));
+
+    struct fox_str_view slice = fox_str_slice(&s, 4, 8);
+    assert(fox_str_view_equal(slice, fox_str_view_of("2,3,")));
+    slice = fox_str_view_slice(slice, 3, 100);
+    assert(fox_str_view_equal(slice, fox_str_view_of(",")));
+
+    struct fox_str copy = fox_str_from_view(slice);
+    assert(is_inline(&copy) && strcmp(fox_str_cstr(&copy), ",") == 0);
+    fox_str_del(&copy);
+
+    fox_str_clear(&s);
+    assert(fox_str_size(&s) == 0 && *fox_str_cstr(&s) == '\0');
+    fox_str_del(&s);
+
+    printf("str: ok\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <alloc.h>
+#include <dump.h>
+
+#define THREADS 4
+#define SLOTS   64
+#define OPS     50000
+
+/* blocks passed between threads, so frees land on other shards' owners */
+static void *shared[SLOTS];
+
+static void *churn(void *arg)
+{
+    u32 state = 2463534242u + (u32) (uintptr_t) arg;
+    void *mine[SLOTS] = {0};
+
+    for (usize i = 0; i < OPS; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        void **slot = mine + state % SLOTS;
+        void *p = fox_alloc(16 + (state >> 16) % 500);
+
+        if (state & (1u << 31))
+            p = __atomic_exchange_n(shared + (state >> 8) % SLOTS, p,
+                __ATOMIC_ACQ_REL);
+
+        fox_free(*slot);
+        *slot = p;
+    }
+
+    for (usize i = 0; i < SLOTS; i++)
+        fox_free(mine[i]);
+
+    return NULL;
+}
+
+static void *free_it(void *p)
+{
+    fox_free(p);
+    return NULL;
+}
+
+/* frees p twice in a child, which must abort */
+static bool double_free_aborts(void *p)
+{
+    pid_t pid = fork();
+    int status;
+
+    if (pid == 0) {
+        fox_free(p);
+        fox_free(p);
+        _exit(0);
+    }
+
+    return waitpid(pid, &status, 0) == pid && WIFSIGNALED(status) &&
+        WTERMSIG(status) == SIGABRT;
+}
+
+int main()
+{
+    fox_alloc_options = "CFDQ";
+
+    pthread_t threads[THREADS];
+
+    for (usize i = 0; i < THREADS; i++)
+        assert(pthread_create(threads + i, NULL, churn, (void*) i) == 0);
+    for (usize i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    /* only the blocks left in shared are live */
+    usize live = 0;
+    for (usize i = 0; i < SLOTS; i++)
+        live += shared[i] != NULL;
+
+    assert(fox_check_all());
+    assert(fox_alloc_snapshot("track.foxstd"));
+
+    struct fox_dump_header header;
+    FILE *in = fopen("track.foxstd", "rb");
+    assert(in != NULL && fread(&header, sizeof(header), 1, in) == 1);
+    fclose(in);
+    remove("track.foxstd");
+    assert(header.count == live);
+
+    for (usize i = 0; i < SLOTS; i++)
+        fox_free(shared[i]);
+
+    /* freed on one thread, freed again on another */
+    void *p = fox_alloc(64);
+    assert(double_free_aborts(p));
+
+    pthread_t t;
+    assert(pthread_create(&t, NULL, free_it, p) == 0);
+    pthread_join(t, NULL);
+    assert(double_free_aborts(p));
+
+    printf("track: ok\n");
+    return 0;
+}
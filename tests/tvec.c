@@ -0,0 +1,64 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include <alloc.h>
+#include <vec.h>
+#include <tvec.h>
+#include <num.h>
+
+struct pair {
+    int key;
+    int value;
+};
+
+FOX_VEC_DEFINE(ints, int)
+FOX_VEC_DEFINE(pairs, struct pair)
+
+bool same_key(const struct pair *a, const struct pair *b)
+{
+    return a->key == b->key;
+}
+
+int main()
+{
+    struct ints v = ints_new();
+
+    for (int i = 0; i < 100; i++)
+        ints_push(&v, i);
+
+    assert(v.size == 100);
+    assert(v.capacity >= 100);
+    assert(ints_at(&v, 42) == 42);
+    assert(*ints_back(&v) == 99);
+    assert(ints_get(&v, 100) == NULL);
+
+    ints_insert(&v, 0, -1);     /* [-1, 0, 1, ..., 99] */
+    ints_remove(&v, 1, NULL);   /* [-1, 1, ..., 99] */
+    assert(ints_at(&v, 0) == -1 && ints_at(&v, 1) == 1);
+    assert(ints_find(&v, 50, NULL) == 50);
+    assert(ints_find(&v, 0, NULL) == -1);
+    assert(ints_pop(&v) == 99);
+
+    /* the generic functions work on the same memory */
+    int val = 1000;
+    fox_vec_push(ints_as_vec(&v), &val);
+    ints_sync(&v);
+    assert(*(int*) fox_vec_get(ints_as_vec(&v), 99) == 1000);
+    assert(v.capacity == fox_allocated(v.items) / sizeof(int));
+
+    ints_del(&v, NULL);
+
+    struct fox_vec generic = fox_vec_new(sizeof(struct pair));
+    struct pair p = { 7, 1 };
+    fox_vec_push(&generic, &p);
+
+    struct pairs typed = pairs_from_vec(generic);
+    pairs_push(&typed, (struct pair) { 8, 2 });
+    assert(pairs_find(&typed, (struct pair) { 8, 0 }, same_key) == 1);
+    assert(pairs_find(&typed, (struct pair) { 8, 0 }, NULL) == -1);
+
+    pairs_del(&typed, NULL);
+
+    printf("tvec: ok\n");
+    return 0;
+}
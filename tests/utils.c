@@ -0,0 +1,130 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <utils.h>
+#include <num.h>
+
+static u8 got[1024], want[1024];
+
+static void reset(void)
+{
+    for (int i = 0; i < 1024; i++)
+        got[i] = want[i] = i * 7 + 3;
+}
+
+static isize naive_search(const u8 *h, usize n, const u8 *s, usize m)
+{
+    for (usize i = 0; i + m <= n; i++)
+        if (memcmp(h + i, s, m) == 0)
+            return i;
+
+    return -1;
+}
+
+/* needles cut from a text of 3 letters, so first and last bytes repeat */
+static void test_search(void)
+{
+    u8 text[200];
+    u32 state = 2463534242u;
+
+    for (usize i = 0; i < sizeof(text); i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        text[i] = 'a' + state % 3;
+    }
+
+    for (usize m = 0; m < 40; m++) {
+        for (usize at = 0; at + m <= sizeof(text); at += 7) {
+            for (usize n = at + m; n <= sizeof(text); n += 13)
+                assert(fox_memsearch(text, n, text + at, m) ==
+                    naive_search(text, n, text + at, m));
+        }
+    }
+
+    assert(fox_memsearch(text, sizeof(text), "abcd", 4) == -1);
+    assert(fox_memsearch(text, 3, text, 4) == -1);
+}
+
+/* every length to 300 from every alignment in a 32-byte register */
+static void test_kernels(void)
+{
+    for (usize len = 0; len < 300; len++) {
+        for (usize src = 300; src < 332; src++) {
+            for (isize shift = -33; shift <= 33; shift += 3) {
+                reset();
+                fox_memmove(got + src + shift, got + src, len);
+                memmove(want + src + shift, want + src, len);
+                assert(memcmp(got, want, sizeof(got)) == 0);
+
+                fox_memcopy(got + 680 + shift, got + src, len);
+                memcpy(want + 680 + shift, want + src, len);
+                assert(memcmp(got, want, sizeof(got)) == 0);
+
+                if (len == 0)
+                    continue;
+
+                got[src + len - 1] ^= 1;
+                assert(fox_memcompare(got + src, want + src, len) != 0);
+                assert((fox_memcompare(got + src, want + src, len) > 0) ==
+                    (memcmp(got + src, want + src, len) > 0));
+                got[src + len - 1] ^= 1;
+                assert(fox_memcompare(got + src, want + src, len) == 0);
+            }
+        }
+    }
+
+    /* powers of two tile a register, the other sizes take another path */
+    for (usize size = 1; size <= 40; size++) {
+        u8 pattern[40];
+        for (usize i = 0; i < size; i++)
+            pattern[i] = i + 1;
+
+        for (usize count = 0; count < 20; count++) {
+            reset();
+            fox_memfill(got + 5, count, pattern, size);
+
+            for (usize i = 0; i < count * size; i++)
+                assert(got[5 + i] == pattern[i % size]);
+            assert(got[4] == want[4]);
+            assert(got[5 + count * size] == want[5 + count * size]);
+        }
+    }
+}
+
+int main()
+{
+    test_kernels();
+
+    u16 shorts[100];
+    u64 longs[37];
+    u8 bytes[70] = {0};
+
+    for (int i = 0; i < 100; i++)
+        shorts[i] = i % 10;
+    for (int i = 0; i < 37; i++)
+        longs[i] = (u64) i << 32;
+
+    u16 s = 7;
+    assert(fox_memfind(shorts, 100, sizeof(u16), &s) == 7);
+    assert(fox_memfind_last(shorts, 100, sizeof(u16), &s) == 97);
+    assert(fox_memcount(shorts, 100, sizeof(u16), &s) == 10);
+
+    /* only the high half matches for every other item */
+    u64 l = (u64) 36 << 32;
+    assert(fox_memfind(longs, 37, sizeof(u64), &l) == 36);
+    l = 36;
+    assert(fox_memfind(longs, 37, sizeof(u64), &l) == -1);
+
+    u8 b = 1;
+    bytes[69] = 1;
+    assert(fox_memfind(bytes, 70, 1, &b) == 69);
+    assert(fox_memfind(bytes, 69, 1, &b) == -1);
+    assert(fox_memcount(bytes, 70, 1, &b) == 1);
+
+    test_search();
+
+    printf("utils: ok\n");
+    return 0;
+}
@@ -1,6 +1,5 @@
 #include <assert.h>
 #include <stdio.h>
-#include <stdlib.h>
 
 #include <vec.h>
 #include <num.h>
@@ -15,9 +14,52 @@ bool comp2(const void *a, const void *b)
     return *(const int*) a == *(const int*) b;
 }
 
-int compare(const void* a, const void* b)
+bool is_even(const void *a)
 {
-    return *(const int*) a - *(const int*) b;
+    return *(const int*) a % 2 == 0;
+}
+
+u64 descending(const void *a)
+{
+    return 1000 - *(const int*) a;
+}
+
+/*
+ * McIlroy's adversary: items start as gas and are frozen to the next solid
+ * value only when two gas items meet, which drives a quicksort towards its
+ * quadratic case. Replaying the frozen values reproduces the same comparisons.
+ */
+#define KILLER 20000
+
+static u32 killer[KILLER];
+static u32 solid, candidate;
+static usize compares;
+
+bool adversary(const void *a, const void *b)
+{
+    u32 x = *(const u32*) a, y = *(const u32*) b;
+
+    compares++;
+    if (killer[x] == KILLER && killer[y] == KILLER)
+        killer[x == candidate ? x : y] = solid++;
+    if (killer[x] == KILLER)
+        candidate = x;
+    else if (killer[y] == KILLER)
+        candidate = y;
+    return killer[x] <= killer[y];
+}
+
+bool comp64(const void *a, const void *b)
+{
+    compares++;
+    return *(const u64*) a <= *(const u64*) b;
+}
+
+struct pair { u64 key, tag; };
+
+bool comp_pair(const void *a, const void *b)
+{
+    return ((const struct pair*) a)->key <= ((const struct pair*) b)->key;
 }
 
 int main()
@@ -50,6 +92,13 @@ int main()
     assert(*(int*) fox_vec_back(&vec) == 77);
     assert(*(int*) fox_vec_get(&vec, 4) == 11);
 
+    fox_vec_rotate(&vec, 16 * 3);       /* whole turns change nothing */
+    fox_vec_rotate_range(&vec, 2, 7, 2);
+    /* [77, 77, 4, 7, 10, 3, 11, 77, 77, 77, 77, 77, 77, 77, 77, 77] */
+    assert(*(int*) fox_vec_get(&vec, 2) == 4);
+    assert(*(int*) fox_vec_get(&vec, 6) == 11);
+    fox_vec_rotate_range(&vec, 2, 7, -2);
+
     fox_vec_remove(&vec, 0, NULL);
     fox_vec_remove(&vec, 4, NULL);
     /* [77, 10, 3, 11, 7, 77, 77, 77, 77, 77, 77, 77, 77, 77] */
@@ -60,7 +109,7 @@ int main()
     /* [77, 10, 3, 11, 7, 77, 77, 77, 77, 77, 77, 77, 77, 77, 5, 5, 5, 5, 5] */
 
     assert(fox_vec_is_sorted(&vec, comp) == 0);
-    qsort(vec.items, vec.size, sizeof(int), compare);
+    fox_vec_sort(&vec, comp);
     assert(fox_vec_is_sorted(&vec, comp) == 1);
 
     val = 11;
@@ -70,9 +119,156 @@ int main()
     assert(*(int*) fox_vec_get(&vec, val) == 11);
     
     int *iter = vec.items;
-    for (int i = 0; i < vec.size; i++, iter++)
+    for (usize i = 0; i < vec.size; i++, iter++)
         printf("%d\n", *iter);
 
     fox_vec_del(&vec, NULL);
+
+    /* stays in the compound literal for at least 4 items, then spills */
+    struct fox_vec small = FOX_VEC_INLINE(int, 4);
+    void *inline_items = small.items;
+    usize inline_cap = fox_allocated(small.items) / sizeof(int);
+    assert(inline_cap >= 4);
+    for (val = 0; val < (int) inline_cap; val++)
+        fox_vec_push(&small, &val);
+    assert(small.items == inline_items);
+    fox_vec_push(&small, &val);
+    assert(small.items != inline_items);
+    for (val = 0; val <= (int) inline_cap; val++)
+        assert(*(int*) fox_vec_get(&small, val) == val);
+    fox_vec_del(&small, NULL);
+
+    struct fox_vec bulk = fox_vec_new(sizeof(int));
+    int batch[40];
+    for (val = 0; val < 40; val++)
+        batch[val] = val;
+
+    fox_vec_push_n(&bulk, batch, 40);       /* [0 .. 39] */
+    fox_vec_insert_n(&bulk, 10, batch, 3);  /* [0 .. 9, 0, 1, 2, 10 .. 39] */
+    assert(bulk.size == 43);
+    assert(*(int*) fox_vec_get(&bulk, 12) == 2);
+    assert(*(int*) fox_vec_get(&bulk, 13) == 10);
+    assert(*(int*) fox_vec_back(&bulk) == 39);
+
+    fox_vec_extend(&bulk, &bulk);
+    assert(bulk.size == 86);
+    assert(*(int*) fox_vec_get(&bulk, 43 + 12) == 2);
+
+    int *span = fox_vec_append_uninit(&bulk, 2);
+    span[0] = -1;
+    span[1] = -2;
+    assert(bulk.size == 88 && *(int*) fox_vec_back(&bulk) == -2);
+
+    fox_vec_stable_sort(&bulk, comp);
+    assert(fox_vec_is_sorted(&bulk, comp));
+    assert(*(int*) fox_vec_front(&bulk) == -2);
+    fox_vec_sort_by_key(&bulk, descending);
+    assert(*(int*) fox_vec_front(&bulk) == 39);
+    assert(*(int*) fox_vec_back(&bulk) == -2);
+
+    fox_vec_sort(&bulk, comp);  /* [-2, -1, 0, 0, 0, 0, 1, 1, 1, 1, 2, ...] */
+    val = 1;
+    assert(fox_vec_count(&bulk, &val, NULL) == 4);
+    assert(fox_vec_count(&bulk, &val, comp2) == 4);
+    assert(fox_vec_find(&bulk, &val, NULL) == 6);
+    assert(fox_vec_find_last(&bulk, &val, NULL) == 9);
+    assert(fox_vec_lower_bound(&bulk, &val, comp) == 6);
+    assert(fox_vec_bsearch(&bulk, &val, comp) == 6);
+    val = 100;
+    assert(fox_vec_lower_bound(&bulk, &val, comp) == bulk.size);
+    assert(fox_vec_bsearch(&bulk, &val, comp) == -1);
+
+    fox_vec_dedup(&bulk, NULL, NULL);   /* [-2, -1, 0, 1, ..., 39] */
+    assert(bulk.size == 42);
+    fox_vec_retain(&bulk, is_even, NULL);   /* [-2, 0, 2, ..., 38] */
+    assert(bulk.size == 21 && *(int*) fox_vec_get(&bulk, 1) == 0);
+    fox_vec_remove_range(&bulk, 1, 11, NULL);   /* [-2, 20, 22, ..., 38] */
+    assert(bulk.size == 11 && *(int*) fox_vec_get(&bulk, 1) == 20);
+    fox_vec_swap_remove(&bulk, 0, NULL);    /* [38, 20, 22, ..., 36] */
+    assert(bulk.size == 10 && *(int*) fox_vec_front(&bulk) == 38);
+    assert(!fox_vec_is_mapped(&bulk) && !fox_vec_map_sync(&bulk, false));
+    fox_vec_del(&bulk, NULL);
+
+    /* the adversary stays within n log n only if the heapsort fallback runs */
+    struct fox_vec ids = fox_vec_new(sizeof(u32));
+    for (u32 i = 0; i < KILLER; i++) {
+        killer[i] = KILLER;
+        fox_vec_push(&ids, &i);
+    }
+    usize bound = 0;
+    for (usize n = KILLER; n > 1; n /= 2)
+        bound += 8 * KILLER;
+    fox_vec_sort(&ids, adversary);
+    assert(compares < bound);
+    fox_vec_del(&ids, NULL);
+
+    /* the frozen input again, as 8 and 16 byte items */
+    struct fox_vec wide = fox_vec_new(sizeof(u64));
+    struct fox_vec pairs = fox_vec_new(sizeof(struct pair));
+    for (usize i = 0; i < KILLER; i++) {
+        u64 key = killer[i];
+        struct pair pair = { key, i };
+        fox_vec_push(&wide, &key);
+        fox_vec_push(&pairs, &pair);
+    }
+    compares = 0;
+    fox_vec_sort(&wide, comp64);
+    assert(compares < bound && fox_vec_is_sorted(&wide, comp64));
+    fox_vec_sort(&pairs, comp_pair);
+    assert(fox_vec_is_sorted(&pairs, comp_pair));
+    u64 tags = 0;
+    for (usize i = 0; i < pairs.size; i++) {
+        struct pair *pair = fox_vec_get(&pairs, i);
+        assert(pair->key == killer[pair->tag]);
+        tags += pair->tag;
+    }
+    assert(tags == (u64) KILLER * (KILLER - 1) / 2);
+    fox_vec_del(&wide, NULL);
+    fox_vec_del(&pairs, NULL);
+
+    /* file backed, opened again with its items where they were left */
+    const char *path = "vecmap.foxstd";
+    remove(path);
+    struct fox_vec missing = fox_vec_map(path, sizeof(int), 0);
+    assert(missing.items == NULL);
+
+    struct fox_vec mapped = fox_vec_map(path, sizeof(int), FOX_VEC_MAP_CREATE);
+    assert(fox_vec_is_mapped(&mapped) && mapped.size == 0);
+    for (val = 0; val < 100000; val++)
+        fox_vec_push(&mapped, &val);
+    val = 77777;
+    assert(fox_vec_find(&mapped, &val, NULL) == 77777);
+    fox_vec_del(&mapped, NULL);
+
+    struct fox_vec reopened = fox_vec_map(path, sizeof(int), 0);
+    assert(reopened.size == 100000);
+    assert(*(int*) fox_vec_back(&reopened) == 99999);
+    assert(fox_vec_map_advise(&reopened, 10, reopened.size, 0));
+    fox_vec_remove_range(&reopened, 10, reopened.size, NULL);
+
+    /* the file is cut down with the mapping, past its 64 byte header */
+    reopened.items = fox_reallocarray(reopened.items, reopened.size,
+        sizeof(int));
+    assert(fox_vec_is_mapped(&reopened));
+    assert(fox_vec_map_sync(&reopened, true));
+    FILE *file = fopen(path, "rb");
+    fseek(file, 0, SEEK_END);
+    assert(ftell(file) == 64 + 10 * sizeof(int));
+    fclose(file);
+    fox_vec_del(&reopened, NULL);
+
+    struct fox_vec wrong = fox_vec_map(path, sizeof(long), 0);
+    assert(wrong.items == NULL);
+
+    struct fox_vec shrunk = fox_vec_map(path, sizeof(int), 0);
+    assert(shrunk.size == 10 && *(int*) fox_vec_back(&shrunk) == 9);
+    fox_vec_del(&shrunk, NULL);
+
+    struct fox_vec emptied = fox_vec_map(path, sizeof(int),
+        FOX_VEC_MAP_TRUNCATE);
+    assert(fox_vec_is_mapped(&emptied) && emptied.size == 0);
+    fox_vec_del(&emptied, NULL);
+    remove(path);
+
     return 0;
 }
@@ -0,0 +1,211 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <num.h>
+#include <dump.h>
+
+/*
+ * foxdump SNAPSHOT          summary of a leak report
+ * foxdump OLD NEW           growth between two reports, by block size
+ */
+
+struct snapshot {
+    const struct fox_dump_header *header;
+    const struct fox_dump_entry *index;
+    usize length;
+};
+
+struct row {
+    u64 size;
+    u64 before;
+    u64 after;
+};
+
+static bool snapshot_open(struct snapshot *snap, const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        return false;
+    }
+
+    void *map = st.st_size ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+        fd, 0) : MAP_FAILED;
+    close(fd);
+
+    if (map == MAP_FAILED || (usize) st.st_size < sizeof(*snap->header)) {
+        fprintf(stderr, "%s: not a foxstd dump\n", path);
+        return false;
+    }
+
+    snap->header = map;
+    snap->length = st.st_size;
+
+    if (memcmp(snap->header->magic, FOX_DUMP_MAGIC, sizeof(FOX_DUMP_MAGIC)) ||
+        snap->header->version != FOX_DUMP_VERSION ||
+        snap->header->index > snap->length ||
+        snap->header->index % sizeof(u64) != 0 ||
+        snap->header->count > (snap->length - snap->header->index) /
+        sizeof(struct fox_dump_entry)) {
+        fprintf(stderr, "%s: not a foxstd dump of version %d\n", path,
+            FOX_DUMP_VERSION);
+        return false;
+    }
+
+    snap->index = (const void*) ((const u8*) map + snap->header->index);
+    posix_madvise(map, snap->length, POSIX_MADV_SEQUENTIAL);
+
+    return true;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    u64 x = *(const u64*) a, y = *(const u64*) b;
+    return (x > y) - (x < y);
+}
+
+static int compare_growth(const void *a, const void *b)
+{
+    const struct row *x = a, *y = b;
+    i64 gx = (i64) (x->after - x->before) * (i64) x->size;
+    i64 gy = (i64) (y->after - y->before) * (i64) y->size;
+
+    return (gx < gy) - (gx > gy);
+}
+
+static u64 *sorted_sizes(const struct snapshot *snap)
+{
+    u64 *sizes = malloc((snap->header->count + 1) * sizeof(u64));
+    if (sizes == NULL)
+        return NULL;
+
+    for (u64 i = 0; i < snap->header->count; i++)
+        sizes[i] = snap->index[i].size;
+
+    qsort(sizes, snap->header->count, sizeof(u64), compare_u64);
+
+    return sizes;
+}
+
+static void summary(const struct snapshot *snap)
+{
+    u64 bytes = 0, screaming = 0;
+
+    for (u64 i = 0; i < snap->header->count; i++) {
+        bytes += snap->index[i].size;
+        screaming += snap->index[i].screaming;
+    }
+
+    printf("blocks:    %llu\n", (unsigned long long) snap->header->count);
+    printf("bytes:     %llu\n", (unsigned long long) bytes);
+    printf("untouched: %llu\n", (unsigned long long) screaming);
+    printf("contents:  %s\n", snap->header->flags & FOX_DUMP_CONTENT ?
+        "yes" : "no");
+}
+
+/* both indexes are sorted by address, a merge walk finds the new blocks */
+static void diff(const struct snapshot *old, const struct snapshot *new)
+{
+    u64 fresh = 0, fresh_bytes = 0;
+    u64 i = 0, j = 0;
+
+    while (j < new->header->count) {
+        if (i < old->header->count &&
+            old->index[i].address < new->index[j].address) {
+            i++;
+        } else if (i < old->header->count &&
+            old->index[i].address == new->index[j].address &&
+            old->index[i].size == new->index[j].size) {
+            i++;
+            j++;
+        } else {
+            fresh++;
+            fresh_bytes += new->index[j++].size;
+        }
+    }
+
+    u64 *a = sorted_sizes(old), *b = sorted_sizes(new);
+    struct row *rows = malloc((old->header->count + new->header->count + 1) *
+        sizeof(*rows));
+    usize n = 0;
+
+    if (a == NULL || b == NULL || rows == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    i = j = 0;
+    while (i < old->header->count || j < new->header->count) {
+        u64 size = j >= new->header->count ? a[i] : i >= old->header->count ?
+            b[j] : a[i] < b[j] ? a[i] : b[j];
+        struct row row = { size, 0, 0 };
+
+        while (i < old->header->count && a[i] == size) {
+            row.before++;
+            i++;
+        }
+
+        while (j < new->header->count && b[j] == size) {
+            row.after++;
+            j++;
+        }
+
+        if (row.before != row.after)
+            rows[n++] = row;
+    }
+
+    qsort(rows, n, sizeof(*rows), compare_growth);
+
+    printf("new blocks: %llu (%llu bytes)\n\n", (unsigned long long) fresh,
+        (unsigned long long) fresh_bytes);
+    printf("%12s %10s %10s %10s %14s\n", "size", "before", "after", "delta",
+        "delta bytes");
+
+    for (usize k = 0; k < n; k++) {
+        i64 delta = (i64) (rows[k].after - rows[k].before);
+
+        printf("%12llu %10llu %10llu %+10lld %+14lld\n",
+            (unsigned long long) rows[k].size,
+            (unsigned long long) rows[k].before,
+            (unsigned long long) rows[k].after, (long long) delta,
+            (long long) delta * (long long) rows[k].size);
+    }
+
+    free(a);
+    free(b);
+    free(rows);
+}
+
+int main(int argc, char **argv)
+{
+    struct snapshot old, new;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s SNAPSHOT\n"
+            "       %s OLD NEW\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    if (!snapshot_open(&old, argv[1]))
+        return 1;
+
+    if (argc == 2) {
+        summary(&old);
+        return 0;
+    }
+
+    if (!snapshot_open(&new, argv[2]))
+        return 1;
+
+    diff(&old, &new);
+    return 0;
+}